@@ -75,6 +75,21 @@ do
 		rm -f $make_log
 	fi
 
+	if [[ $SOURCE_DIR == *"C++11"* ]] ; then
+		echo -e "\t Test for BLAKE2b"
+		if ./../../Build/argon2-blake2-kat > /dev/null ; then
+			echo -e "\t\t -> OK!"
+		else
+			echo -e "\t\t -> Wrong! Run ./../../Build/argon2-blake2-kat for details!"
+		fi
+		echo -e "\t Test of the API"
+		if ./../../Build/argon2-api-test > /dev/null ; then
+			echo -e "\t\t -> OK!"
+		else
+			echo -e "\t\t -> Wrong! Run ./../../Build/argon2-api-test for details!"
+		fi
+	fi
+
 
 	for type in ${ARGON2_TYPES[@]}
 	do
@@ -0,0 +1,228 @@
+#!/bin/bash
+
+#
+# Argon2 source code package
+#
+# This work is licensed under a Creative Commons CC0 1.0 License/Waiver.
+#
+# You should have received a copy of the CC0 Public Domain Dedication along with
+# this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+#
+
+#
+# Runs the same parameter points through every implementation family and prints one side-by-side table:
+#	./compare_implementations.sh [-m=LOGM,...] [-t=T,...] [-p=P,...] [-types=d,i,id,ds] [-r=REPEATS]
+#
+# The families are built with their own makefiles and drivers into a private directory:
+#	C99-ref, C99-opt	Source/C99		make argon2 [OPT=TRUE]
+#	C++11-ref, C++11-opt	Source/C++11		make argon2-bench [OPT=TRUE]
+#	v1.2-ref, v1.2-sse	v.1.2/v.1.2/Argon2{d,i}	make in ref/ and opt-sse/
+#
+# Every cell is the median wall-clock time of -r runs of the whole process, measured the same way for all families.
+# v1.2 only has Argon2d and Argon2i with a single lane, and implements an older version of the algorithm, so its
+# cells are empty for other points and its times are only comparable, not its tags. Some of the v1.2 snapshots do
+# not build (Argon2d opt-sse lacks its input validation, the ref drivers call missing functions); their cells are
+# empty too and the make log is kept in Output/.
+#
+
+
+# Get current script path
+script_path=$(dirname $0)
+
+
+# Change current directory to root directory
+if [ '.' != $script_path ] ; then
+	cd $script_path/../
+else
+	cd ..
+fi
+ROOT_DIR=$(pwd)
+
+OUTPUT_PATH=$ROOT_DIR/Output/
+WORK_DIR=$OUTPUT_PATH"compare"
+CSV_FILE=$OUTPUT_PATH"compare_implementations.csv"
+
+VARIANTS=(C99-ref C99-opt C++11-ref C++11-opt v1.2-ref v1.2-sse)
+
+
+# Default arguments
+LOG_M_COSTS=(12 16)
+T_COSTS=(1 3)
+PARALLELISMS=(1 4)
+TYPES=(d i id ds)
+REPEATS=5
+
+# Parse script arguments
+for i in "$@"
+do
+	case $i in
+		-m=*)
+			IFS=',' read -ra LOG_M_COSTS <<< "${i#*=}"
+			;;
+		-t=*)
+			IFS=',' read -ra T_COSTS <<< "${i#*=}"
+			;;
+		-p=*)
+			IFS=',' read -ra PARALLELISMS <<< "${i#*=}"
+			;;
+		-types=*)
+			IFS=',' read -ra TYPES <<< "${i#*=}"
+			;;
+		-r=*|-repeat=*)
+			REPEATS="${i#*=}"
+			;;
+		*)
+			echo "Usage: $0 [-m=LOGM,...] [-t=T,...] [-p=P,...] [-types=d,i,id,ds] [-r=REPEATS]"
+			exit 1
+			;;
+	esac
+done
+
+
+mkdir -p $WORK_DIR
+
+
+# Builds variant $1 into $WORK_DIR, returns non-zero if it can not be built
+build_variant() {
+	local variant=$1
+	local make_log=$OUTPUT_PATH"make_compare_"$variant".log"
+	local flags=""
+	case $variant in
+		*-opt)
+			flags="OPT=TRUE"
+			;;
+	esac
+
+	case $variant in
+		C99-*)
+			(cd $ROOT_DIR/Source/C99 && make argon2 $flags) &> $make_log &&
+				mv $ROOT_DIR/Build/argon2 $WORK_DIR/$variant
+			;;
+		C++11-*)
+			(cd $ROOT_DIR/Source/C++11 && make argon2-bench $flags) &> $make_log &&
+				mv $ROOT_DIR/Build/argon2-bench $WORK_DIR/$variant
+			;;
+		v1.2-*)
+			local dir=ref
+			if [ "v1.2-sse" == "$variant" ] ; then
+				dir=opt-sse
+			fi
+			# The trees are snapshots and not all of them build: keep the types that do
+			rm -f $make_log $WORK_DIR/$variant-*
+			for type in d i ; do
+				local tree=$ROOT_DIR/v.1.2/v.1.2/Argon2$type/$dir
+				local binary=argon2$type
+				if [ "ref" == "$dir" ] ; then
+					binary=$binary-ref
+				fi
+				(cd $tree && make) &>> $make_log && mv $tree/$binary $WORK_DIR/$variant-$type
+			done
+			ls $WORK_DIR/$variant-* &> /dev/null
+			;;
+	esac
+	local result=$?
+	if [ 0 -eq $result ] && ! grep -q "Error" $make_log ; then
+		rm -f $make_log
+	fi
+	return $result
+}
+
+# Prints the command line of variant $1 for type $2, log2 of m_cost $3, t_cost $4 and parallelism $5,
+# or nothing if the variant does not support the point
+command_line() {
+	local variant=$1 type=$2 log_m=$3 t_cost=$4 p=$5
+	case $variant in
+		C99-*)
+			echo "$WORK_DIR/$variant -type Argon2$type -logmcost $log_m -tcost $t_cost -lanes $p -threads $p"
+			;;
+		C++11-*)
+			echo "$WORK_DIR/$variant -type $type -m $log_m -t $t_cost -lanes $p -threads $p -warmup 0 -repeat 1"
+			;;
+		v1.2-*)
+			if [ 1 -eq $p ] && [ -x $WORK_DIR/$variant-$type ] ; then
+				echo "$WORK_DIR/$variant-$type -logmcost $log_m -tcost $t_cost"
+			fi
+			;;
+	esac
+}
+
+# Prints the median wall-clock time in milliseconds of $REPEATS runs of command $@
+median_time() {
+	local times=()
+	for (( r = 0; r < REPEATS; ++r )) ; do
+		local start=$(date +%s%N)
+		"$@" > /dev/null 2>&1 || return 1
+		local stop=$(date +%s%N)
+		times+=($(( (stop - start) / 1000 )))
+	done
+	local median=$(printf "%s\n" "${times[@]}" | sort -n | sed -n "$(( (REPEATS + 1) / 2 ))p")
+	printf "%d.%03d" $(( median / 1000 )) $(( median % 1000 ))
+}
+
+
+echo "Building"
+built=()
+for variant in ${VARIANTS[@]}
+do
+	if build_variant $variant ; then
+		built+=($variant)
+	else
+		echo -e "\t $variant -> Make error! See "$OUTPUT_PATH"make_compare_"$variant".log for details!"
+	fi
+done
+echo
+
+
+# Header
+printf "%-4s %6s %3s %3s" "type" "m" "t" "p"
+echo -n "type,log_m_cost,t_cost,parallelism" > $CSV_FILE
+for variant in ${built[@]}
+do
+	printf " %11s" $variant
+	echo -n ",$variant" >> $CSV_FILE
+done
+printf "   %s\n" "fastest"
+echo ",fastest" >> $CSV_FILE
+
+
+for type in ${TYPES[@]}
+do
+	for log_m in ${LOG_M_COSTS[@]}
+	do
+		for t_cost in ${T_COSTS[@]}
+		do
+			for p in ${PARALLELISMS[@]}
+			do
+				printf "%-4s %6s %3s %3s" $type "2^$log_m" $t_cost $p
+				echo -n "$type,$log_m,$t_cost,$p" >> $CSV_FILE
+				fastest="-"
+				fastest_time=""
+				for variant in ${built[@]}
+				do
+					cell="-"
+					command=$(command_line $variant $type $log_m $t_cost $p)
+					if [ -n "$command" ] ; then
+						cell=$(median_time $command) || cell="error"
+					fi
+					if [[ $cell =~ ^[0-9] ]] ; then
+						printf " %8s ms" $cell
+						if [ -z "$fastest_time" ] || (( 10#${cell/./} < 10#${fastest_time/./} )) ; then
+							fastest=$variant
+							fastest_time=$cell
+						fi
+					else
+						printf " %11s" $cell
+						cell=""
+					fi
+					echo -n ",$cell" >> $CSV_FILE
+				done
+				printf "   %s\n" $fastest
+				echo ",$fastest" >> $CSV_FILE
+			done
+		done
+	done
+done
+
+
+echo
+echo "CSV written to $CSV_FILE"
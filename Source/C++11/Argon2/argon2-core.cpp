@@ -12,9 +12,26 @@
 
 
 #include <inttypes.h>
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+#include <string>
 #include <vector>
 #include <thread>
 #include <cstring>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define ARGON2_HAVE_MMAP
+#endif
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define ARGON2_HAVE_STREAMING_STORES
+#endif
 
 #include "argon2.h"
 #include "argon2-core.h"
@@ -49,55 +66,473 @@ int AllocateMemory(block **memory, uint32_t m_cost) {
 }
 
 
-void ClearMemory(Argon2_instance_t* instance, bool clear) {
-    if (instance->memory != NULL && clear) {
-        if (instance->type == Argon2_ds && instance->Sbox != NULL) {
-            secure_wipe_memory(instance->Sbox, ARGON2_SBOX_SIZE * sizeof (uint64_t));
+int MapMemory(block **memory, uint32_t m_cost) {
+    if (memory == NULL) {
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+#ifdef ARGON2_HAVE_MMAP
+    void* p = mmap(NULL, (size_t) m_cost * sizeof (block), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == p) {
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(p, (size_t) m_cost * sizeof (block), MADV_HUGEPAGE); //fewer TLB misses on random references
+#endif
+    *memory = (block*) p;
+    return ARGON2_OK;
+#else
+    return AllocateMemory(memory, m_cost);
+#endif
+}
+
+int MapFile(block **memory, uint32_t m_cost, const char *directory) {
+    if (memory == NULL || directory == NULL) {
+        return ARGON2_BACKING_FILE_ERROR;
+    }
+#ifdef ARGON2_HAVE_MMAP
+    const size_t size = (size_t) m_cost * sizeof (block);
+    // A new file that no other path refers to: an existing file or symlink in the directory is never opened
+    int fd = -1;
+#ifdef O_TMPFILE
+    fd = open(directory, O_TMPFILE | O_RDWR | O_EXCL, 0600);
+#endif
+    if (fd < 0) { // no O_TMPFILE, or the file system does not support it
+        std::string path = std::string(directory) + "/argon2-XXXXXX";
+        fd = mkstemp(&path[0]);
+        if (fd < 0) {
+            return ARGON2_BACKING_FILE_ERROR;
         }
-        secure_wipe_memory(instance->memory, sizeof (block) * instance->memory_blocks);
+        unlink(path.c_str());
     }
+    void* p = MAP_FAILED;
+    if (0 == ftruncate(fd, (off_t) size)) {
+        p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd); //the mapping keeps the file alive
+    if (MAP_FAILED == p) {
+        return ARGON2_BACKING_FILE_ERROR;
+    }
+    madvise(p, size, MADV_RANDOM); //reference blocks are read at random, readahead around faults is useless
+    *memory = (block*) p;
+    return ARGON2_OK;
+#else
+    return ARGON2_BACKING_FILE_ERROR;
+#endif
 }
 
-void FreeMemory(block* memory) {
+void UnmapMemory(block *memory, uint32_t m_cost) {
+#ifdef ARGON2_HAVE_MMAP
+    munmap(memory, (size_t) m_cost * sizeof (block));
+#else
     delete[] memory;
-    memory=nullptr;
+#endif
 }
 
-void Finalize(const Argon2_Context *context, Argon2_instance_t* instance) {
-    if (context != NULL && instance != NULL) {
-        block blockhash = instance->memory[instance->lane_length - 1];
+/*
+ * Steady clock in nanoseconds, for Argon2_Stats
+ */
+static uint64_t StatsNow() {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-        // XOR the last blocks
-        for (uint32_t l = 1; l < instance->lanes; ++l) {
-            uint32_t last_block_in_lane = l * instance->lane_length + (instance->lane_length - 1);
-            blockhash ^= instance->memory[last_block_in_lane];
+/*
+ * Adds the time since @a lap to @a phase of @a stats and starts the next lap there. Does nothing if @a stats is NULL
+ */
+static void StatsLap(Argon2_Stats* stats, uint64_t Argon2_Stats::*phase, uint64_t* lap) {
+    if (NULL != stats) {
+        const uint64_t now = StatsNow();
+        stats->*phase += now - *lap;
+        *lap = now;
+    }
+}
 
+/*
+ * Zeroes @a stats, keeping the caller buffer of the lane times (which is zeroed as well)
+ */
+static void ResetStats(Argon2_Stats* stats) {
+    uint64_t* lane_ns = stats->lane_ns;
+    const uint32_t lane_capacity = stats->lane_capacity;
+    *stats = Argon2_Stats();
+    stats->lane_ns = lane_ns;
+    stats->lane_capacity = lane_capacity;
+    if (NULL != lane_ns) {
+        memset(lane_ns, 0, lane_capacity * sizeof (uint64_t));
+    }
+}
+
+/*
+ * Passes a record to the trace callback of @a instance. Does nothing if the instance is not traced
+ */
+static void Trace(const Argon2_instance_t* instance, Argon2_TraceEvent event, Argon2_TracePhase phase, uint32_t pass,
+        uint32_t lane, uint32_t slice) {
+    if (NULL == instance->traced) {
+        return;
+    }
+    Argon2_TraceRecord record;
+    record.event = event;
+    record.phase = phase;
+    record.context = instance->traced;
+    record.pass = pass;
+    record.lane = lane;
+    record.slice = slice;
+    record.thread_id = (uint64_t) std::hash<std::thread::id>()(std::this_thread::get_id());
+    record.timestamp_ns = StatsNow();
+    instance->traced->trace_cbk(instance->traced->trace_user, &record);
+}
+
+/*
+ * FillSegment() that is traced and writes its compute time to @a ns (unless NULL), for Argon2_Stats
+ */
+static void InstrumentedFillSegment(const Argon2_instance_t* instance, Argon2_position_t position, uint64_t* ns) {
+    Trace(instance, ARGON2_TRACE_SEGMENT_BEGIN, ARGON2_PHASE_NONE, position.pass, position.lane, position.slice);
+    const uint64_t start = (NULL != ns) ? StatsNow() : 0;
+    FillSegment(instance, position);
+    if (NULL != ns) {
+        *ns = StatsNow() - start;
+    }
+    Trace(instance, ARGON2_TRACE_SEGMENT_END, ARGON2_PHASE_NONE, position.pass, position.lane, position.slice);
+}
+
+/* Zeroes @count blocks with non-temporal stores, so that the wipe does not evict the cache */
+static void WipeBlocks(block* blocks, size_t count) {
+#ifdef ARGON2_HAVE_STREAMING_STORES
+    if (0 == ((uintptr_t) blocks & (sizeof (__m128i) - 1))) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i* p = (__m128i*) blocks->v;
+        const size_t n = count * (ARGON2_BLOCK_SIZE / sizeof (__m128i));
+        for (size_t i = 0; i < n; ++i) {
+            _mm_stream_si128(p + i, zero);
         }
+        _mm_sfence();
+        __asm__ __volatile__("" : : "r"(blocks) : "memory"); //the stores must survive the following free
+        return;
+    }
+#endif
+    secure_wipe_memory(blocks, count * sizeof (block));
+}
 
-        // Hash the result
-        blake2b_long(context->out,  context->outlen,(uint8_t*) blockhash.v, ARGON2_BLOCK_SIZE);
-        secure_wipe_memory(blockhash.v, ARGON2_BLOCK_SIZE); //clear the blockhash
+void WipeLanes(const Argon2_instance_t* instance, uint32_t worker, uint32_t workers) {
+    if (instance == NULL) {
+        return;
+    }
+    for (uint32_t l = worker; l < instance->lane_memory.size(); l += workers) {
+        if (instance->lane_memory[l] != NULL) {
+            WipeBlocks(instance->lane_memory[l], instance->lane_length);
+        }
+    }
+}
 
-        if(context->print){ //Shall we print the output tag?
-            PrintTag(context->out, context->outlen);
+/* The memory is allocated in chunks: one per lane if the instance is segmented, a single one otherwise.
+ * Chunk c starts at lane_memory[c] */
+static uint32_t ChunkCount(const Argon2_instance_t* instance) {
+    return instance->segmented ? instance->lanes : 1;
+}
+
+static uint32_t ChunkBlocks(const Argon2_instance_t* instance) {
+    return instance->segmented ? instance->lane_length : instance->memory_blocks;
+}
+
+void ClearMemory(Argon2_instance_t* instance, const Argon2_Context* context) {
+    if (instance->lane_memory.empty() || !context->clear_memory) {
+        return;
+    }
+    if (instance->type == Argon2_ds && instance->Sbox != NULL) {
+        secure_wipe_memory(instance->Sbox, ARGON2_SBOX_SIZE * sizeof (uint64_t));
+    }
+#ifdef ARGON2_HAVE_MMAP
+    if (instance->memory_mapped && !instance->file_backed && !instance->memory_locked && context->discard_memory) {
+        for (uint32_t c = 0; c < ChunkCount(instance); ++c) {
+            if (instance->lane_memory[c] != NULL) {
+                madvise(instance->lane_memory[c], (size_t) ChunkBlocks(instance) * sizeof (block), MADV_DONTNEED);
+            }
         }
+        return;
+    }
+#endif
+    const uint32_t workers = ARGON2_MIN(instance->threads, instance->lanes);
+    if (workers == 1) {
+        WipeLanes(instance, 0, 1);
+        return;
+    }
+    std::vector<std::thread> Threads;
+    for (uint32_t w = 0; w < workers; ++w) {
+        Threads.push_back(std::thread(WipeLanes, instance, w, workers));
+    }
+    MetricsThreadsStarted(workers);
+    for (auto& t : Threads) {
+        t.join();
+    }
+}
 
-        // Clear memory
-        ClearMemory(instance, context->clear_memory);
+int LockMemory(void *memory, size_t bytes) {
+#ifdef ARGON2_HAVE_MMAP
+    if (0 == mlock(memory, bytes)) {
+        return ARGON2_OK;
+    }
+#endif
+    return ARGON2_MEMORY_LOCK_ERROR;
+}
 
-        // Deallocate Sbox memory
-        if (instance->memory != NULL && instance->Sbox != NULL) {
-            delete[] instance->Sbox;
+void UnlockMemory(void *memory, size_t bytes) {
+#ifdef ARGON2_HAVE_MMAP
+    munlock(memory, bytes);
+#endif
+}
+
+/* Allocates @words of scratch. With @own_pages they are mapped on pages of their own, so that locking and unlocking
+ * them cannot affect another allocation: mlock() does not nest, munlock() of a shared heap page would unlock it for
+ * every call that locked it */
+static uint64_t* AllocateScratch(size_t words, bool own_pages) {
+#ifdef ARGON2_HAVE_MMAP
+    if (own_pages) {
+        void* p = mmap(NULL, words * sizeof (uint64_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return (MAP_FAILED == p) ? NULL : (uint64_t*) p;
+    }
+#endif
+    return new (std::nothrow) uint64_t[words];
+}
+
+/* Frees scratch of AllocateScratch(), unlocking it first if it has pages of its own */
+static void FreeScratch(uint64_t* scratch, size_t words, bool own_pages) {
+#ifdef ARGON2_HAVE_MMAP
+    if (own_pages) {
+        UnlockMemory(scratch, words * sizeof (uint64_t));
+        munmap(scratch, words * sizeof (uint64_t));
+        return;
+    }
+#endif
+    delete[] scratch;
+}
+
+int AcquireMemory(Argon2_instance_t* instance, const Argon2_Context* context) {
+    instance->segmented = context->segmented_memory && NULL == context->backing_file;
+    const uint32_t chunk_blocks = ChunkBlocks(instance);
+    const size_t chunk_bytes = (size_t) chunk_blocks * sizeof (block);
+    int result = ARGON2_OK;
+    instance->lane_memory.assign(instance->lanes, NULL);
+    // All chunks come from the same source, set once: if a later chunk fails, FreeMemory() releases the earlier ones
+    // the way they were allocated
+    const bool own_source = NULL == context->allocate_cbk && NULL == context->memory_pool;
+    instance->file_backed = own_source && NULL != context->backing_file;
+#ifdef ARGON2_HAVE_MMAP
+    instance->memory_mapped = instance->file_backed || (own_source && (context->map_memory || context->lock_memory));
+#endif
+    for (uint32_t c = 0; c < ChunkCount(instance) && ARGON2_OK == result; ++c) {
+        block* memory = NULL;
+        if (NULL != context->allocate_cbk) {
+            uint8_t *p = NULL;
+            result = context->allocate_cbk(&p, chunk_bytes);
+            memory = (block*) p;
+        } else if (NULL != context->memory_pool) {
+            Argon2_MemoryRegion* region = AcquireRegion(context->memory_pool, chunk_blocks);
+            if (NULL == region) {
+                result = ARGON2_MEMORY_ALLOCATION_ERROR;
+            } else {
+                instance->regions.push_back(region);
+                memory = region->memory;
+            }
+        } else if (NULL != context->backing_file) {
+            result = MapFile(&memory, chunk_blocks, context->backing_file);
+        } else if (context->map_memory || context->lock_memory) { // locked memory must not share pages with the heap
+            result = MapMemory(&memory, chunk_blocks);
+        } else {
+            result = AllocateMemory(&memory, chunk_blocks);
+        }
+        if (ARGON2_OK == result) {
+            instance->lane_memory[c] = memory;
         }
+    }
+    if (ARGON2_OK != result) {
+        FreeMemory(instance, context);
+        return result;
+    }
+    if (!instance->segmented) {
+        for (uint32_t l = 1; l < instance->lanes; ++l) {
+            instance->lane_memory[l] = instance->lane_memory[0] + (size_t) l * instance->lane_length;
+        }
+    }
+
+    // The S-box and the address scratch are allocated once per call, FillSegment() does not allocate
+    instance->scratch_mapped = context->lock_memory;
+    if (Argon2_ds == instance->type) {
+        instance->Sbox = AllocateScratch(ARGON2_SBOX_SIZE, instance->scratch_mapped);
+        if (NULL == instance->Sbox) {
+            result = ARGON2_MEMORY_ALLOCATION_ERROR;
+        }
+    }
+    if ((Argon2_i == instance->type || Argon2_id == instance->type) && NULL == instance->address_table) {
+        instance->pseudo_rands = AllocateScratch((size_t) instance->lanes * instance->segment_length,
+                instance->scratch_mapped);
+        if (NULL == instance->pseudo_rands) {
+            result = ARGON2_MEMORY_ALLOCATION_ERROR;
+        }
+    }
+
+    if (ARGON2_OK == result && context->lock_memory) {
+        if (!instance->regions.empty()) {
+            for (Argon2_MemoryRegion* region : instance->regions) {
+                if (ARGON2_OK == result && !region->locked) {
+                    result = LockMemory(region->memory, (size_t) region->blocks * sizeof (block));
+                    region->locked = (ARGON2_OK == result);
+                    region->warm = region->warm || region->locked; //mlock() faults the pages in
+                }
+            }
+        } else {
+            instance->memory_locked = true; //unlocking the chunks that failed to lock is harmless
+            for (uint32_t c = 0; c < ChunkCount(instance) && ARGON2_OK == result; ++c) {
+                result = LockMemory(instance->lane_memory[c], chunk_bytes);
+            }
+        }
+        if (ARGON2_OK == result && NULL != instance->Sbox) {
+            result = LockMemory(instance->Sbox, ARGON2_SBOX_SIZE * sizeof (uint64_t));
+        }
+        if (ARGON2_OK == result && NULL != instance->pseudo_rands) {
+            result = LockMemory(instance->pseudo_rands, (size_t) instance->lanes * instance->segment_length * sizeof (uint64_t));
+        }
+    }
+
+    if (ARGON2_OK != result) {
+        FreeMemory(instance, context);
+        return result;
+    }
+    instance->memory_acquired = true;
+    instance->metered_bytes = (uint64_t) instance->memory_blocks * sizeof (block);
+    MetricsMemory((int64_t) instance->metered_bytes);
+    if (NULL != instance->stats) {
+        instance->stats->memory_bytes = (uint64_t) instance->memory_blocks * sizeof (block);
+        if (NULL != instance->Sbox) {
+            instance->stats->memory_bytes += ARGON2_SBOX_SIZE * sizeof (uint64_t);
+        }
+        if (NULL != instance->pseudo_rands) {
+            instance->stats->memory_bytes += (uint64_t) instance->lanes * instance->segment_length * sizeof (uint64_t);
+        }
+    }
+    return result;
+}
 
-        // Deallocate the memory
+void FreeMemory(Argon2_instance_t* instance, const Argon2_Context* context) {
+    if (instance->lane_memory.empty()) {
+        return;
+    }
+    uint64_t lap = (NULL != instance->stats) ? StatsNow() : 0;
+    Trace(instance, ARGON2_TRACE_PHASE_BEGIN, ARGON2_PHASE_FREE, 0, 0, 0);
+
+    // Clear memory
+    ClearMemory(instance, context);
+    StatsLap(instance->stats, &Argon2_Stats::wipe_ns, &lap);
+
+    // Deallocate the S-box and the scratch
+    if (instance->Sbox != NULL) {
+        FreeScratch(instance->Sbox, ARGON2_SBOX_SIZE, instance->scratch_mapped);
+        instance->Sbox = NULL;
+    }
+    if (instance->pseudo_rands != NULL) {
+        FreeScratch(instance->pseudo_rands, (size_t) instance->lanes * instance->segment_length, instance->scratch_mapped);
+        instance->pseudo_rands = NULL;
+    }
+
+    // Deallocate the memory chunk by chunk
+    const uint32_t chunk_blocks = ChunkBlocks(instance);
+    for (uint32_t c = 0; c < ChunkCount(instance); ++c) {
+        block* memory = instance->lane_memory[c];
+        if (memory == NULL) {
+            continue;
+        }
+        if (instance->memory_locked) {
+            UnlockMemory(memory, (size_t) chunk_blocks * sizeof (block));
+        }
         if (NULL != context->free_cbk) {
-            context->free_cbk((uint8_t *) instance->memory, instance->memory_blocks * sizeof (block));
+            context->free_cbk((uint8_t *) memory, (size_t) chunk_blocks * sizeof (block));
+        } else if (!instance->regions.empty()) {
+            // Regions are released below
+        } else if (instance->memory_mapped) {
+            UnmapMemory(memory, chunk_blocks);
+        } else {
+            delete[] memory;
+        }
+    }
+    for (Argon2_MemoryRegion* region : instance->regions) {
+        // The hash wrote every page of a region it was given; if AcquireMemory() failed, e.g. on mlock(), only a
+        // successful lock has faulted the pages in
+        region->warm = region->warm || instance->memory_acquired;
+        ReleaseRegion(context->memory_pool, region);
+    }
+    instance->regions.clear();
+    instance->memory_locked = false;
+    instance->memory_acquired = false;
+    instance->lane_memory.clear();
+    MetricsMemory(-(int64_t) instance->metered_bytes);
+    instance->metered_bytes = 0;
+    StatsLap(instance->stats, &Argon2_Stats::free_ns, &lap);
+    Trace(instance, ARGON2_TRACE_PHASE_END, ARGON2_PHASE_FREE, 0, 0, 0);
+}
+
+void Finalize(const Argon2_Context *context, Argon2_instance_t* instance) {
+    if (context != NULL && instance != NULL) {
+        uint64_t lap = (NULL != instance->stats) ? StatsNow() : 0;
+        Trace(instance, ARGON2_TRACE_PHASE_BEGIN, ARGON2_PHASE_FINALIZE, 0, 0, 0);
+        block blockhash = instance->lane_memory[0][instance->lane_length - 1];
+
+        // XOR the last blocks
+        for (uint32_t l = 1; l < instance->lanes; ++l) {
+            blockhash ^= instance->lane_memory[l][instance->lane_length - 1];
+        }
+
+        // Hash the result, or let the stream hash it as it is read
+        if (NULL != context->output_stream) {
+            OpenOutputStream(context->output_stream, context->outlen, (uint8_t*) blockhash.v, ARGON2_BLOCK_SIZE);
         } else {
-            FreeMemory(instance->memory);
+            blake2b_long(context->out,  context->outlen,(uint8_t*) blockhash.v, ARGON2_BLOCK_SIZE);
+            if(context->print){ //Shall we print the output tag?
+                PrintTag(context->out, context->outlen);
+            }
         }
+        secure_wipe_memory(blockhash.v, ARGON2_BLOCK_SIZE); //clear the blockhash
+        StatsLap(instance->stats, &Argon2_Stats::finalize_ns, &lap);
+        Trace(instance, ARGON2_TRACE_PHASE_END, ARGON2_PHASE_FINALIZE, 0, 0, 0);
+
+        // Clear and deallocate the memory
+        FreeMemory(instance, context);
+    }
+}
+
+static uint32_t AlignedMemoryBlocks(const Argon2_Context* context);
+
+/*
+ * Number of data-independent slices: all of them in Argon2i, the first half of the first pass in Argon2id
+ */
+static uint32_t DataIndependentSlices(const Argon2_instance_t* instance) {
+    if (Argon2_i == instance->type) {
+        return instance->passes * ARGON2_SYNC_POINTS;
+    }
+    if (Argon2_id == instance->type) {
+        return ARGON2_SYNC_POINTS / 2;
+    }
+    return 0;
+}
+
+const uint64_t* SegmentAddresses(const Argon2_instance_t* instance, const Argon2_position_t* position) {
+    if (NULL != instance->address_table) {
+        // Slices are numbered across passes, the lanes of a slice are consecutive
+        const size_t slice = (size_t) position->pass * ARGON2_SYNC_POINTS + position->slice;
+        return instance->address_table + (slice * instance->lanes + position->lane) * instance->segment_length;
+    }
+    uint64_t* pseudo_rands = instance->pseudo_rands + (size_t) position->lane * instance->segment_length;
+    GenerateAddresses(instance, position, pseudo_rands);
+    return pseudo_rands;
+}
 
+std::vector<uint64_t> AddressTable(const Argon2_Context* context, Argon2_type type) {
+    const Argon2_instance_t instance(type, context->t_cost, AlignedMemoryBlocks(context), context->lanes, 1, false);
+    std::vector<uint64_t> table((size_t) DataIndependentSlices(&instance) * instance.lanes * instance.segment_length);
+    for (uint32_t s = 0; s < DataIndependentSlices(&instance); ++s) {
+        for (uint32_t l = 0; l < instance.lanes; ++l) {
+            const Argon2_position_t position(s / ARGON2_SYNC_POINTS, l, (uint8_t) (s % ARGON2_SYNC_POINTS), 0);
+            GenerateAddresses(&instance, &position, &table[((size_t) s * instance.lanes + l) * instance.segment_length]);
+        }
     }
+    return table;
 }
 
 uint32_t IndexAlpha(const Argon2_instance_t* instance, const Argon2_position_t* position, uint32_t pseudo_rand, bool same_lane) {
@@ -149,18 +584,64 @@ uint32_t IndexAlpha(const Argon2_instance_t* instance, const Argon2_position_t*
     return absolute_position;
 }
 
+void PrefetchReferenceBlocks(const Argon2_instance_t* instance, Argon2_position_t position, const uint64_t* pseudo_rands,
+        uint32_t begin, uint32_t end) {
+#ifdef ARGON2_HAVE_MMAP
+    if (end > instance->segment_length) {
+        end = instance->segment_length;
+    }
+    static const uintptr_t page_size = (uintptr_t) sysconf(_SC_PAGESIZE);
+    for (uint32_t i = begin; i < end; ++i) {
+        uint64_t ref_lane = (pseudo_rands[i] >> 32) % instance->lanes;
+        if ((position.pass == 0) && (position.slice == 0)) {
+            ref_lane = position.lane;
+        }
+        position.index = i;
+        uint32_t ref_index = IndexAlpha(instance, &position, pseudo_rands[i] & 0xFFFFFFFF, ref_lane == position.lane);
+        uintptr_t ref_block = (uintptr_t) (instance->lane_memory[ref_lane] + ref_index);
+        uintptr_t page = ref_block & ~(page_size - 1);
+        madvise((void*) page, ref_block + ARGON2_BLOCK_SIZE - page, MADV_WILLNEED);
+    }
+#endif
+}
+
 void FillMemoryBlocks(Argon2_instance_t* instance) {
     std::vector<std::thread> Threads;
     if (instance == NULL) {
         return;
     }
+    Argon2_Stats* stats = instance->stats;
+    std::vector<uint64_t> segment_ns(NULL != stats ? instance->lanes : 0); //compute time of the segments of a slice
+    const bool instrumented = (NULL != stats) || (NULL != instance->traced);
+    const uint64_t start = StatsNow();
+    uint64_t lap = start;
+    uint32_t threads_started = 0;
     for (uint32_t r = 0; r < instance->passes; ++r) {
+        Trace(instance, ARGON2_TRACE_PHASE_BEGIN, ARGON2_PHASE_PASS, r, 0, 0);
         if (Argon2_ds == instance->type) {
             GenerateSbox(instance);
+            if (NULL != stats) {
+                stats->sbox_ns += StatsNow() - lap;
+            }
         }
         for (uint8_t s = 0; s < ARGON2_SYNC_POINTS; ++s) {
+            const uint64_t slice_start = (NULL != stats) ? StatsNow() : 0;
             for (uint32_t l = 0; l < instance->lanes; ++l) {
-                Threads.push_back(std::thread(FillSegment, instance, Argon2_position_t(r, l, s, 0)));
+                if (1 == instance->threads) { // no concurrency to gain, save the thread creation
+                    if (instrumented) {
+                        InstrumentedFillSegment(instance, Argon2_position_t(r, l, s, 0), (NULL != stats) ? &segment_ns[l] : NULL);
+                    } else {
+                        FillSegment(instance, Argon2_position_t(r, l, s, 0));
+                    }
+                    continue;
+                }
+                if (instrumented) {
+                    Threads.push_back(std::thread(InstrumentedFillSegment, instance, Argon2_position_t(r, l, s, 0),
+                            (NULL != stats) ? &segment_ns[l] : NULL));
+                } else {
+                    Threads.push_back(std::thread(FillSegment, instance, Argon2_position_t(r, l, s, 0)));
+                }
+                ++threads_started;
                 if(instance->threads <= Threads.size()){ //have to join extra threads
                     for (auto& t : Threads) {
                         t.join();
@@ -174,11 +655,78 @@ void FillMemoryBlocks(Argon2_instance_t* instance) {
                 }
                 Threads.clear();
             }
+            if (NULL != stats) {
+                const uint64_t slice_ns = StatsNow() - slice_start;
+                uint64_t busy = 0;
+                for (uint32_t l = 0; l < instance->lanes; ++l) {
+                    busy += segment_ns[l];
+                    if (l < stats->lane_capacity && NULL != stats->lane_ns) {
+                        stats->lane_ns[l] += segment_ns[l];
+                    }
+                }
+                const uint64_t capacity = (uint64_t) ARGON2_MIN(instance->threads, instance->lanes) * slice_ns;
+                stats->slices_ns += slice_ns;
+                stats->barrier_wait_ns[s] += (capacity > busy) ? capacity - busy : 0;
+            }
         }
         if(instance->internal_print){
             InternalKat(instance, r); // Print all memory blocks
         }
+        if (NULL != instance->stats) {
+            const uint64_t now = StatsNow();
+            instance->stats->pass_ns[ARGON2_MIN(r, ARGON2_STATS_MAX_PASSES - 1)] += now - lap;
+            lap = now;
+        }
+        Trace(instance, ARGON2_TRACE_PHASE_END, ARGON2_PHASE_PASS, r, 0, 0);
+    }
+    MetricsThreadsStarted(threads_started);
+    MetricsTime(0, StatsNow() - start, 0);
+}
+
+/*
+ * Total length of an input given either as one array or as a list of parts
+ */
+static uint64_t InputLength(const uint8_t* data, uint32_t length, const Argon2_InputPart* parts, uint32_t count) {
+    if (NULL == parts) {
+        return (NULL == data) ? 0 : length;
+    }
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        total += parts[i].length;
+    }
+    return total;
+}
+
+/*
+ * Validates an input given either as one array or as a list of parts, returning the given error codes
+ */
+static int ValidateInput(const uint8_t* data, uint32_t length, const Argon2_InputPart* parts, uint32_t count,
+        uint64_t min_length, uint64_t max_length, int too_short, int too_long, int ptr_mismatch) {
+    if (NULL == parts) {
+        if (0 != count) {
+            return ptr_mismatch;
+        }
+        if (NULL == data) {
+            return (0 != length) ? ptr_mismatch : ARGON2_OK;
+        }
+    } else {
+        if (NULL != data || 0 != length) { //only one of the forms may be used
+            return ptr_mismatch;
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            if (NULL == parts[i].data && 0 != parts[i].length) {
+                return ptr_mismatch;
+            }
+        }
     }
+    const uint64_t total = InputLength(data, length, parts, count);
+    if (min_length != 0 && min_length > total) {
+        return too_short;
+    }
+    if (max_length < total) {
+        return too_long;
+    }
+    return ARGON2_OK;
 }
 
 int ValidateInputs(const Argon2_Context* context) {
@@ -186,7 +734,7 @@ int ValidateInputs(const Argon2_Context* context) {
         return ARGON2_INCORRECT_PARAMETER;
     }
 
-    if (NULL == context->out) {
+    if (NULL == context->out && NULL == context->output_stream) {
         return ARGON2_OUTPUT_PTR_NULL;
     }
 
@@ -199,59 +747,31 @@ int ValidateInputs(const Argon2_Context* context) {
     }
 
     /* Validate password length */
-    if (NULL == context->pwd) {
-        if (0 != context->pwdlen) {
-            return ARGON2_PWD_PTR_MISMATCH;
-        }
-    } else {
-        if (ARGON2_MIN_PWD_LENGTH != 0 && ARGON2_MIN_PWD_LENGTH > context->pwdlen) {
-            return ARGON2_PWD_TOO_SHORT;
-        }
-        if (ARGON2_MAX_PWD_LENGTH < context->pwdlen) {
-            return ARGON2_PWD_TOO_LONG;
-        }
+    int result = ValidateInput(context->pwd, context->pwdlen, context->pwd_parts, context->pwd_parts_count,
+            ARGON2_MIN_PWD_LENGTH, ARGON2_MAX_PWD_LENGTH, ARGON2_PWD_TOO_SHORT, ARGON2_PWD_TOO_LONG, ARGON2_PWD_PTR_MISMATCH);
+    if (ARGON2_OK != result) {
+        return result;
     }
 
     /* Validate salt length */
-    if (NULL == context->salt) {
-        if (0 != context->saltlen) {
-            return ARGON2_SALT_PTR_MISMATCH;
-        }
-    } else {
-        if (ARGON2_MIN_SALT_LENGTH > context->saltlen) {
-            return ARGON2_SALT_TOO_SHORT;
-        }
-        if (ARGON2_MAX_SALT_LENGTH < context->saltlen) {
-            return ARGON2_SALT_TOO_LONG;
-        }
+    result = ValidateInput(context->salt, context->saltlen, context->salt_parts, context->salt_parts_count,
+            ARGON2_MIN_SALT_LENGTH, ARGON2_MAX_SALT_LENGTH, ARGON2_SALT_TOO_SHORT, ARGON2_SALT_TOO_LONG, ARGON2_SALT_PTR_MISMATCH);
+    if (ARGON2_OK != result) {
+        return result;
     }
 
     /* Validate secret length */
-    if (NULL == context->secret) {
-        if (0 != context->secretlen) {
-            return ARGON2_SECRET_PTR_MISMATCH;
-        }
-    } else {
-        if (ARGON2_MIN_SECRET > context->secretlen) {
-            return ARGON2_SECRET_TOO_SHORT;
-        }
-        if (ARGON2_MAX_SECRET < context->secretlen) {
-            return ARGON2_SECRET_TOO_LONG;
-        }
+    result = ValidateInput(context->secret, context->secretlen, context->secret_parts, context->secret_parts_count,
+            ARGON2_MIN_SECRET, ARGON2_MAX_SECRET, ARGON2_SECRET_TOO_SHORT, ARGON2_SECRET_TOO_LONG, ARGON2_SECRET_PTR_MISMATCH);
+    if (ARGON2_OK != result) {
+        return result;
     }
 
     /* Validate associated data */
-    if (NULL == context->ad) {
-        if (0 != context->adlen) {
-            return ARGON2_AD_PTR_MISMATCH;
-        }
-    } else {
-        if (ARGON2_MIN_AD_LENGTH > context->adlen) {
-            return ARGON2_AD_TOO_SHORT;
-        }
-        if (ARGON2_MAX_AD_LENGTH < context->adlen) {
-            return ARGON2_AD_TOO_LONG;
-        }
+    result = ValidateInput(context->ad, context->adlen, context->ad_parts, context->ad_parts_count,
+            ARGON2_MIN_AD_LENGTH, ARGON2_MAX_AD_LENGTH, ARGON2_AD_TOO_SHORT, ARGON2_AD_TOO_LONG, ARGON2_AD_PTR_MISMATCH);
+    if (ARGON2_OK != result) {
+        return result;
     }
 
     /* Validate memory cost */
@@ -298,14 +818,112 @@ int ValidateInputs(const Argon2_Context* context) {
 }
 
 void FillFirstBlocks(uint8_t* blockhash, const Argon2_instance_t* instance) {
-    // Make the first and second block in each lane as G(H0||i||0) or G(H0||i||1)
-    for (uint32_t l = 0; l < instance->lanes; ++l) {
-        store32(blockhash+ARGON2_PREHASH_DIGEST_LENGTH + 4,l);
-        store32(blockhash+ARGON2_PREHASH_DIGEST_LENGTH,0);
-        blake2b_long((uint8_t*) (instance->memory[l * instance->lane_length].v),  ARGON2_BLOCK_SIZE,blockhash, ARGON2_PREHASH_SEED_LENGTH);
+    FillFirstBlocksBatch(&blockhash, &instance, 1);
+}
 
-        store32(blockhash+ARGON2_PREHASH_DIGEST_LENGTH,1);
-        blake2b_long((uint8_t*) (instance->memory[l * instance->lane_length + 1].v),  ARGON2_BLOCK_SIZE,blockhash, ARGON2_PREHASH_SEED_LENGTH);
+void FillFirstBlocksBatch(uint8_t* const* blockhashes, const Argon2_instance_t* const* instances, uint32_t count) {
+    // Make the first and second block in each lane as G(H0||i||0) or G(H0||i||1).
+    // The seeds of up to ARGON2_FIRST_BLOCKS_BATCH blocks, from any of the instances, are hashed together by the multi-buffer BLAKE2b
+    uint8_t seeds[ARGON2_FIRST_BLOCKS_BATCH][ARGON2_PREHASH_SEED_LENGTH];
+    const void* inputs[ARGON2_FIRST_BLOCKS_BATCH];
+    void* outputs[ARGON2_FIRST_BLOCKS_BATCH];
+    uint32_t pending = 0;
+
+    for (uint32_t k = 0; k < count; ++k) {
+        const Argon2_instance_t* instance = instances[k];
+        for (uint32_t l = 0; l < instance->lanes; ++l) {
+            for (uint32_t i = 0; i < 2; ++i) {
+                memcpy(seeds[pending], blockhashes[k], ARGON2_PREHASH_DIGEST_LENGTH);
+                store32(seeds[pending] + ARGON2_PREHASH_DIGEST_LENGTH, i);
+                store32(seeds[pending] + ARGON2_PREHASH_DIGEST_LENGTH + 4, l);
+                inputs[pending] = seeds[pending];
+                outputs[pending] = instance->lane_memory[l][i].v;
+                pending++;
+            }
+            if (pending == ARGON2_FIRST_BLOCKS_BATCH) {
+                blake2b_long_multi(outputs, ARGON2_BLOCK_SIZE, inputs, ARGON2_PREHASH_SEED_LENGTH, pending);
+                pending = 0;
+            }
+        }
+    }
+    if (pending > 0) {
+        blake2b_long_multi(outputs, ARGON2_BLOCK_SIZE, inputs, ARGON2_PREHASH_SEED_LENGTH, pending);
+    }
+    secure_wipe_memory(seeds, sizeof (seeds));
+}
+
+void PrefaultLanes(const Argon2_instance_t* instance, uint32_t worker, uint32_t workers) {
+    if (instance == NULL || instance->lane_memory.empty()) {
+        return;
+    }
+    for (uint32_t l = worker; l < instance->lanes; l += workers) {
+        block* lane = instance->lane_memory[l];
+        for (uint32_t i = 2; i < instance->lane_length; i += ARGON2_BLOCKS_IN_PAGE) {
+            lane[i][0] = 0;
+        }
+    }
+}
+
+/*
+ * Absorbs the length and the bytes of an input given either as one array or as a list of parts
+ */
+static void AbsorbInput(blake2b_state* state, const uint8_t* data, uint32_t length, const Argon2_InputPart* parts,
+        uint32_t count) {
+    uint8_t value[sizeof (uint32_t)];
+    // The length is written as given for a contiguous input, even with a NULL array
+    store32(&value, (NULL == parts) ? length : (uint32_t) InputLength(data, length, parts, count));
+    blake2b_update(state, (const uint8_t*) &value, sizeof (value));
+    if (NULL == parts) {
+        if (data != NULL) {
+            blake2b_update(state, data, length);
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        if (parts[i].length > 0) {
+            blake2b_update(state, parts[i].data, parts[i].length);
+        }
+    }
+}
+
+/*
+ * Wipes an input given either as one array or as a list of parts, and sets its length(s) to 0
+ */
+static void ClearInput(uint8_t* data, uint32_t& length, Argon2_InputPart* parts, uint32_t count) {
+    if (NULL == parts) {
+        if (data != NULL) {
+            secure_wipe_memory(data, length);
+            length = 0;
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        if (parts[i].length > 0) {
+            secure_wipe_memory(const_cast<uint8_t*> (parts[i].data), parts[i].length);
+            parts[i].length = 0;
+        }
+    }
+}
+
+/*
+ * Copies the length and the bytes of an input given either as one array or as a list of parts, advancing @a output
+ */
+static void CopyInput(uint8_t*& output, const uint8_t* data, uint32_t length, const Argon2_InputPart* parts,
+        uint32_t count) {
+    store32(output, (NULL == parts) ? length : (uint32_t) InputLength(data, length, parts, count));
+    output += sizeof (uint32_t);
+    if (NULL == parts) {
+        if (data != NULL) {
+            memcpy(output, data, length);
+            output += length;
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        if (parts[i].length > 0) {
+            memcpy(output, parts[i].data, parts[i].length);
+            output += parts[i].length;
+        }
     }
 }
 
@@ -337,38 +955,68 @@ void InitialHash(uint8_t* blockhash, Argon2_Context* context, Argon2_type type)
     store32(&value, (uint32_t) type);
     blake2b_update(&BlakeHash, (const uint8_t*) &value, sizeof (value));
 
-    store32(&value, context->pwdlen);
-    blake2b_update(&BlakeHash, (const uint8_t*) &value, sizeof (value));
-    if (context->pwd != NULL) {
-        blake2b_update(&BlakeHash, (const uint8_t*) context->pwd, context->pwdlen);
-        if (context->clear_password) {
-            secure_wipe_memory(context->pwd, context->pwdlen);
-            context->pwdlen = 0;
-        }
+    AbsorbInput(&BlakeHash, context->pwd, context->pwdlen, context->pwd_parts, context->pwd_parts_count);
+    if (context->clear_password) {
+        ClearInput(context->pwd, context->pwdlen, context->pwd_parts, context->pwd_parts_count);
     }
 
-    store32(&value, context->saltlen);
-    blake2b_update(&BlakeHash, (const uint8_t*) &value, sizeof (value));
-    if (context->salt != NULL) {
-        blake2b_update(&BlakeHash, (const uint8_t*) context->salt, context->saltlen);
+    AbsorbInput(&BlakeHash, context->salt, context->saltlen, context->salt_parts, context->salt_parts_count);
+
+    AbsorbInput(&BlakeHash, context->secret, context->secretlen, context->secret_parts, context->secret_parts_count);
+    if (context->clear_secret) {
+        ClearInput(context->secret, context->secretlen, context->secret_parts, context->secret_parts_count);
     }
 
-    store32(&value, context->secretlen);
-    blake2b_update(&BlakeHash, (const uint8_t*) &value, sizeof (value));
-    if (context->secret != NULL) {
-        blake2b_update(&BlakeHash, (const uint8_t*) context->secret, context->secretlen);
-        if (context->clear_secret) {
-            secure_wipe_memory(context->secret, context->secretlen);
-            context->secretlen = 0;
-        }
+    AbsorbInput(&BlakeHash, context->ad, context->adlen, context->ad_parts, context->ad_parts_count);
+    blake2b_final(&BlakeHash, blockhash, ARGON2_PREHASH_DIGEST_LENGTH);
+}
+
+size_t InitialHashInputLength(const Argon2_Context* context) {
+    // lanes, outlen, m_cost, t_cost, version, type and the four length prefixes
+    return 10 * sizeof (uint32_t)
+            + InputLength(context->pwd, context->pwdlen, context->pwd_parts, context->pwd_parts_count)
+            + InputLength(context->salt, context->saltlen, context->salt_parts, context->salt_parts_count)
+            + InputLength(context->secret, context->secretlen, context->secret_parts, context->secret_parts_count)
+            + InputLength(context->ad, context->adlen, context->ad_parts, context->ad_parts_count);
+}
+
+void InitialHashInput(uint8_t* input, Argon2_Context* context, Argon2_type type) {
+    // Same order as the fields absorbed by InitialHash()
+    store32(input, context->lanes);
+    input += sizeof (uint32_t);
+    store32(input, context->outlen);
+    input += sizeof (uint32_t);
+    store32(input, context->m_cost);
+    input += sizeof (uint32_t);
+    store32(input, context->t_cost);
+    input += sizeof (uint32_t);
+    store32(input, ARGON2_VERSION_NUMBER);
+    input += sizeof (uint32_t);
+    store32(input, (uint32_t) type);
+    input += sizeof (uint32_t);
+
+    CopyInput(input, context->pwd, context->pwdlen, context->pwd_parts, context->pwd_parts_count);
+    if (context->clear_password) {
+        ClearInput(context->pwd, context->pwdlen, context->pwd_parts, context->pwd_parts_count);
     }
 
-    store32(&value, context->adlen);
-    blake2b_update(&BlakeHash, (const uint8_t*) &value, sizeof (value));
-    if (context->ad != NULL) {
-        blake2b_update(&BlakeHash, (const uint8_t*) context->ad, context->adlen);
+    CopyInput(input, context->salt, context->saltlen, context->salt_parts, context->salt_parts_count);
+
+    CopyInput(input, context->secret, context->secretlen, context->secret_parts, context->secret_parts_count);
+    if (context->clear_secret) {
+        ClearInput(context->secret, context->secretlen, context->secret_parts, context->secret_parts_count);
     }
-    blake2b_final(&BlakeHash, blockhash, ARGON2_PREHASH_DIGEST_LENGTH);
+
+    CopyInput(input, context->ad, context->adlen, context->ad_parts, context->ad_parts_count);
+}
+
+static bool MemoryIsWarm(const Argon2_instance_t* instance, const Argon2_Context* context) {
+    // Memory from the user allocator is assumed to be warm, locked memory is faulted in by mlock()
+    bool warm = (NULL != context->allocate_cbk) || instance->memory_locked || !instance->regions.empty();
+    for (Argon2_MemoryRegion* region : instance->regions) {
+        warm = warm && region->warm;
+    }
+    return warm;
 }
 
 int Initialize(Argon2_instance_t* instance, Argon2_Context* context) {
@@ -376,27 +1024,30 @@ int Initialize(Argon2_instance_t* instance, Argon2_Context* context) {
         return ARGON2_INCORRECT_PARAMETER;
     
     // 1. Memory allocation
-    int result = ARGON2_OK;
-    if (NULL != context->allocate_cbk) {
-         uint8_t *p;
-        result = context->allocate_cbk(&p, instance->memory_blocks *
-                                               ARGON2_BLOCK_SIZE);
-        if (ARGON2_OK != result) {
-            return result;
-        }
-        memcpy(&(instance->memory), p, sizeof(instance->memory));
-    } else {
-        result = AllocateMemory(&(instance->memory), instance->memory_blocks);
-    }
-
+    uint64_t lap = (NULL != instance->stats) ? StatsNow() : 0;
+    Trace(instance, ARGON2_TRACE_PHASE_BEGIN, ARGON2_PHASE_ALLOCATE, 0, 0, 0);
+    int result = AcquireMemory(instance, context);
+    Trace(instance, ARGON2_TRACE_PHASE_END, ARGON2_PHASE_ALLOCATE, 0, 0, 0);
     if (ARGON2_OK != result) {
         return result;
     }
+    StatsLap(instance->stats, &Argon2_Stats::allocate_ns, &lap);
+
+    // 2. Faulting in the fresh memory in parallel with the initial hashing
+    std::vector<std::thread> prefault_threads;
+    if (context->prefault_memory && !MemoryIsWarm(instance, context)) {
+        const uint32_t workers = ARGON2_MIN(instance->threads, instance->lanes);
+        for (uint32_t w = 0; w < workers; ++w) {
+            prefault_threads.push_back(std::thread(PrefaultLanes, instance, w, workers));
+        }
+        MetricsThreadsStarted(workers);
+    }
 
-    // 2. Initial hashing
+    // 3. Initial hashing
     // H_0 + 8 extra bytes to produce the first blocks
     uint8_t blockhash[ARGON2_PREHASH_SEED_LENGTH];
     // Hashing all inputs
+    Trace(instance, ARGON2_TRACE_PHASE_BEGIN, ARGON2_PHASE_INITIAL_HASH, 0, 0, 0);
     InitialHash(blockhash, context, instance->type);
     // Zeroing 8 extra bytes
     secure_wipe_memory(blockhash + ARGON2_PREHASH_DIGEST_LENGTH, ARGON2_PREHASH_SEED_LENGTH - ARGON2_PREHASH_DIGEST_LENGTH);
@@ -404,26 +1055,25 @@ int Initialize(Argon2_instance_t* instance, Argon2_Context* context) {
     if(context->print){ //shall we print the current state
         InitialKat(blockhash, context, instance->type);
     }
+    StatsLap(instance->stats, &Argon2_Stats::initial_hash_ns, &lap);
+    Trace(instance, ARGON2_TRACE_PHASE_END, ARGON2_PHASE_INITIAL_HASH, 0, 0, 0);
 
-    // 3. Creating first blocks, we always have at least two blocks in a slice
+    // 4. Creating first blocks, we always have at least two blocks in a slice
+    Trace(instance, ARGON2_TRACE_PHASE_BEGIN, ARGON2_PHASE_FIRST_BLOCKS, 0, 0, 0);
     FillFirstBlocks(blockhash, instance);
     // Clearing the hash
     secure_wipe_memory(blockhash, ARGON2_PREHASH_SEED_LENGTH);
 
+    for (auto& t : prefault_threads) {
+        t.join();
+    }
+    StatsLap(instance->stats, &Argon2_Stats::first_blocks_ns, &lap);
+    Trace(instance, ARGON2_TRACE_PHASE_END, ARGON2_PHASE_FIRST_BLOCKS, 0, 0, 0);
+
     return ARGON2_OK;
 }
 
-int Argon2Core(Argon2_Context* context, Argon2_type type) {
-    /* 1. Validate all inputs */
-    int result = ValidateInputs(context);
-    if (ARGON2_OK != result) {
-        return result;
-    }
-    if (Argon2_d != type && Argon2_i != type && Argon2_id != type && Argon2_ds != type) {
-        return ARGON2_INCORRECT_TYPE;
-    }
-
-    /* 2. Align memory size */
+static uint32_t AlignedMemoryBlocks(const Argon2_Context* context) {
     // Minimum memory_blocks = 8L blocks, where L is the number of lanes
     uint32_t memory_blocks = context->m_cost;
     if (memory_blocks < 2 * ARGON2_SYNC_POINTS * context->lanes) {
@@ -431,21 +1081,231 @@ int Argon2Core(Argon2_Context* context, Argon2_type type) {
     }
     uint32_t segment_length = memory_blocks / (context->lanes * ARGON2_SYNC_POINTS);
     // Ensure that all segments have equal length
-    memory_blocks = segment_length * (context->lanes * ARGON2_SYNC_POINTS);
+    return segment_length * (context->lanes * ARGON2_SYNC_POINTS);
+}
+
+/*
+ * Splits @a indices into groups of equal @a lengths[index], keeping the order within a group
+ */
+static std::vector<std::vector<uint32_t>> GroupByLength(const std::vector<uint32_t>& indices, const std::vector<size_t>& lengths) {
+    std::vector<std::vector<uint32_t>> groups;
+    for (uint32_t index : indices) {
+        bool placed = false;
+        for (auto& group : groups) {
+            if (lengths[group.front()] == lengths[index]) {
+                group.push_back(index);
+                placed = true;
+                break;
+            }
+        }
+        if (!placed) {
+            groups.push_back(std::vector<uint32_t>(1, index));
+        }
+    }
+    return groups;
+}
+
+int Argon2Core(Argon2_Context* context, Argon2_type type, const uint64_t* address_table) {
+    Argon2_Stats* stats = (NULL != context) ? context->stats : NULL;
+    const uint64_t start = StatsNow();
+    uint64_t lap = start;
+    if (NULL != stats) {
+        ResetStats(stats);
+    }
+    MetricsHashStarted(type);
+
+    /* 1. Validate all inputs */
+    int result = ValidateInputs(context);
+    StatsLap(stats, &Argon2_Stats::validate_ns, &lap);
+    if (ARGON2_OK == result && Argon2_d != type && Argon2_i != type && Argon2_id != type && Argon2_ds != type) {
+        result = ARGON2_INCORRECT_TYPE;
+    }
+    if (ARGON2_OK != result) {
+        MetricsHashFinished(type, result);
+        return result;
+    }
+
+    /* 2. Align memory size */
+    uint32_t memory_blocks = AlignedMemoryBlocks(context);
     const bool print_internals = context->print; //Should we print the memory blocks to the file
-    Argon2_instance_t instance(NULL, type, context->t_cost, memory_blocks, context->lanes, context->threads,print_internals);
+    Argon2_instance_t instance(type, context->t_cost, memory_blocks, context->lanes, context->threads,print_internals);
+    instance.address_table = address_table;
+    instance.stats = stats;
+    if (NULL != stats) {
+        stats->passes = instance.passes;
+        stats->threads = ARGON2_MIN(instance.threads, instance.lanes);
+    }
+    instance.traced = (NULL != context->trace_cbk) ? context : NULL;
+    Trace(&instance, ARGON2_TRACE_HASH_BEGIN, ARGON2_PHASE_NONE, 0, 0, 0);
 
     /* 3. Initialization: Hashing inputs, allocating memory, filling first blocks */
     result = Initialize(&instance, context);
     if (ARGON2_OK != result) {
+        Trace(&instance, ARGON2_TRACE_HASH_END, ARGON2_PHASE_NONE, 0, 0, 0);
+        MetricsTime(StatsNow() - start, 0, 0);
+        MetricsHashFinished(type, result);
         return result;
     }
+    const uint64_t fill_start = StatsNow();
 
     /* 4. Filling memory */
     FillMemoryBlocks(&instance);
 
     /* 5. Finalization */
+    const uint64_t finalize_start = StatsNow();
     Finalize(context, &instance);
+    Trace(&instance, ARGON2_TRACE_HASH_END, ARGON2_PHASE_NONE, 0, 0, 0);
 
+    const uint64_t stop = StatsNow();
+    MetricsTime(fill_start - start, 0, stop - finalize_start); //FillMemoryBlocks() adds the fill time
+    MetricsHashFinished(type, ARGON2_OK);
+    if (NULL != stats) {
+        stats->total_ns = stop - start;
+    }
     return ARGON2_OK;
 }
+
+int Argon2CoreBatch(Argon2_Context** contexts, uint32_t count, Argon2_type type, int* results) {
+    if (NULL == contexts && count > 0) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+
+    std::vector<int> status(count, ARGON2_OK);
+    std::vector<Argon2_instance_t*> instances(count, NULL);
+    std::vector<uint32_t> active;
+    const uint64_t start = StatsNow();
+
+    /* 1. Validation and memory allocation */
+    for (uint32_t k = 0; k < count; ++k) {
+        Argon2_Context* context = contexts[k];
+        Argon2_Stats* stats = (NULL != context) ? context->stats : NULL;
+        uint64_t lap = 0;
+        if (NULL != stats) {
+            ResetStats(stats);
+            lap = StatsNow();
+        }
+        MetricsHashStarted(type);
+        status[k] = ValidateInputs(context);
+        StatsLap(stats, &Argon2_Stats::validate_ns, &lap);
+        if (ARGON2_OK == status[k] && Argon2_d != type && Argon2_i != type && Argon2_id != type && Argon2_ds != type) {
+            status[k] = ARGON2_INCORRECT_TYPE;
+        }
+        if (ARGON2_OK != status[k]) {
+            continue;
+        }
+        instances[k] = new Argon2_instance_t(type, context->t_cost, AlignedMemoryBlocks(context), context->lanes,
+                context->threads, context->print);
+        instances[k]->stats = stats;
+        if (NULL != stats) {
+            stats->passes = instances[k]->passes;
+            stats->threads = ARGON2_MIN(instances[k]->threads, instances[k]->lanes);
+        }
+        instances[k]->traced = (NULL != context->trace_cbk) ? context : NULL;
+        Trace(instances[k], ARGON2_TRACE_HASH_BEGIN, ARGON2_PHASE_NONE, 0, 0, 0);
+        status[k] = AcquireMemory(instances[k], context);
+        if (ARGON2_OK != status[k]) {
+            Trace(instances[k], ARGON2_TRACE_HASH_END, ARGON2_PHASE_NONE, 0, 0, 0);
+            delete instances[k];
+            instances[k] = NULL;
+            continue;
+        }
+        StatsLap(stats, &Argon2_Stats::allocate_ns, &lap);
+        if (context->prefault_memory && !MemoryIsWarm(instances[k], context)) {
+            PrefaultLanes(instances[k], 0, 1);
+        }
+        active.push_back(k);
+    }
+
+    /* 2. Initial hashing, multi-buffered over contexts whose inputs have the same length */
+    std::vector<uint8_t> blockhashes(count * ARGON2_PREHASH_SEED_LENGTH);
+    std::vector<size_t> input_lengths(count, 0);
+    for (uint32_t k : active) {
+        input_lengths[k] = InitialHashInputLength(contexts[k]);
+    }
+    for (const auto& group : GroupByLength(active, input_lengths)) {
+        const size_t length = input_lengths[group.front()];
+        std::vector<uint8_t> inputs(group.size() * length);
+        std::vector<const void*> in(group.size());
+        std::vector<void*> out(group.size());
+        for (size_t g = 0; g < group.size(); ++g) {
+            InitialHashInput(&inputs[g * length], contexts[group[g]], type);
+            in[g] = &inputs[g * length];
+            out[g] = &blockhashes[group[g] * ARGON2_PREHASH_SEED_LENGTH];
+        }
+        blake2b_multi(out.data(), ARGON2_PREHASH_DIGEST_LENGTH, in.data(), length, group.size());
+        secure_wipe_memory(inputs.data(), inputs.size());
+    }
+
+    /* 3. First blocks of every instance, multi-buffered across instances */
+    std::vector<uint8_t*> seeds;
+    std::vector<const Argon2_instance_t*> seeded;
+    for (uint32_t k : active) {
+        uint8_t* blockhash = &blockhashes[k * ARGON2_PREHASH_SEED_LENGTH];
+        if (contexts[k]->print) {
+            InitialKat(blockhash, contexts[k], type);
+        }
+        seeds.push_back(blockhash);
+        seeded.push_back(instances[k]);
+    }
+    FillFirstBlocksBatch(seeds.data(), seeded.data(), (uint32_t) seeds.size());
+    secure_wipe_memory(blockhashes.data(), blockhashes.size());
+
+    /* 4. Filling memory */
+    const uint64_t fill_start = StatsNow();
+    for (uint32_t k : active) {
+        FillMemoryBlocks(instances[k]);
+    }
+    const uint64_t finalize_start = StatsNow();
+
+    /* 5. Finalization, multi-buffered over contexts with the same tag length. Streamed tags are computed when read */
+    std::vector<block> final_blocks(count);
+    std::vector<size_t> tag_lengths(count, 0);
+    std::vector<uint32_t> tagged;
+    for (uint32_t k : active) {
+        const Argon2_instance_t* instance = instances[k];
+        final_blocks[k] = instance->lane_memory[0][instance->lane_length - 1];
+        for (uint32_t l = 1; l < instance->lanes; ++l) {
+            final_blocks[k] ^= instance->lane_memory[l][instance->lane_length - 1];
+        }
+        if (NULL != contexts[k]->output_stream) {
+            OpenOutputStream(contexts[k]->output_stream, contexts[k]->outlen, (uint8_t*) final_blocks[k].v, ARGON2_BLOCK_SIZE);
+            continue;
+        }
+        tag_lengths[k] = contexts[k]->outlen;
+        tagged.push_back(k);
+    }
+    for (const auto& group : GroupByLength(tagged, tag_lengths)) {
+        std::vector<const void*> in(group.size());
+        std::vector<void*> out(group.size());
+        for (size_t g = 0; g < group.size(); ++g) {
+            in[g] = final_blocks[group[g]].v;
+            out[g] = contexts[group[g]]->out;
+        }
+        blake2b_long_multi(out.data(), tag_lengths[group.front()], in.data(), ARGON2_BLOCK_SIZE, group.size());
+    }
+    secure_wipe_memory(final_blocks.data(), final_blocks.size() * sizeof (block));
+
+    int result = ARGON2_OK;
+    for (uint32_t k = 0; k < count; ++k) {
+        if (NULL != instances[k]) {
+            if (contexts[k]->print && NULL == contexts[k]->output_stream) {
+                PrintTag(contexts[k]->out, contexts[k]->outlen);
+            }
+            FreeMemory(instances[k], contexts[k]);
+            Trace(instances[k], ARGON2_TRACE_HASH_END, ARGON2_PHASE_NONE, 0, 0, 0);
+            delete instances[k];
+        }
+        if (NULL != contexts && NULL != contexts[k] && NULL != contexts[k]->stats) {
+            contexts[k]->stats->total_ns = StatsNow() - start;
+        }
+        MetricsHashFinished(type, status[k]);
+        if (NULL != results) {
+            results[k] = status[k];
+        }
+        if (ARGON2_OK == result) {
+            result = status[k];
+        }
+    }
+    MetricsTime(fill_start - start, 0, StatsNow() - finalize_start);
+    return result;
+}
@@ -17,6 +17,9 @@
 #define __ARGON2_CORE_H__
 
 #include <cstring> 
+#include <vector>
+
+#include "blake2.h"
 
 /*************************Argon2 internal constants**************************************************/
 
@@ -28,6 +31,12 @@ const uint32_t ARGON2_BLOCK_SIZE = 1024;
 const uint32_t ARGON2_WORDS_IN_BLOCK = ARGON2_BLOCK_SIZE / sizeof (uint64_t);
 const uint32_t ARGON2_QWORDS_IN_BLOCK = ARGON2_WORDS_IN_BLOCK / 2;
 
+/* Number of blocks in the smallest memory page, used to fault in the memory */
+const uint32_t ARGON2_BLOCKS_IN_PAGE = 4096 / ARGON2_BLOCK_SIZE;
+
+/* Number of reference blocks of a data-independent segment that are requested from the backing file in one go */
+const uint32_t ARGON2_PREFETCH_WINDOW = 64;
+
 /* Number of pseudo-random values generated by one call to Blake in Argon2i  to generate reference block positions*/
 const uint32_t ARGON2_ADDRESSES_IN_BLOCK = (ARGON2_BLOCK_SIZE * sizeof (uint8_t) / sizeof (uint64_t));
 
@@ -35,13 +44,9 @@ const uint32_t ARGON2_ADDRESSES_IN_BLOCK = (ARGON2_BLOCK_SIZE * sizeof (uint8_t)
 const uint32_t ARGON2_PREHASH_DIGEST_LENGTH = 64;
 const uint32_t ARGON2_PREHASH_SEED_LENGTH = ARGON2_PREHASH_DIGEST_LENGTH + 8;
 
-/* Argon2 primitive type */
-enum Argon2_type {
-    Argon2_d=0,
-    Argon2_i=1,
-    Argon2_id=2,
-    Argon2_ds=4
-};
+/* Number of first blocks whose seeds FillFirstBlocks() passes to one blake2b_long_multi() call */
+const uint32_t ARGON2_FIRST_BLOCKS_BATCH = 16;
+
 
 
 /*****SM-related constants******/
@@ -95,12 +100,32 @@ struct block {
  */
 block operator^(const block& l, const block& r);
 
+/*
+ * Region of a memory pool: mapped memory that is reused across calls
+ */
+struct Argon2_MemoryRegion {
+    block* memory; //Mapped memory
+    const uint32_t blocks; //Number of blocks in the region
+    bool locked; //whether the region is locked in RAM
+    bool warm; //whether the pages have been faulted in by a previous call
+
+    Argon2_MemoryRegion(block* ptr, uint32_t b) : memory(ptr), blocks(b), locked(false), warm(false) {
+    };
+};
+
+/*
+ * Output stream: incremental blake2b_long over the final block. Defined here so that it can live on the stack
+ */
+struct Argon2_OutputStream {
+    blake2b_long_state state; //incremental blake2b_long over the final block
+};
+
 /*
  * Argon2 instance: memory pointer, number of passes, amount of memory, type, and derived values. 
  * Used to evaluate the number and location of blocks to construct in each thread
  */
 struct Argon2_instance_t {
-    block*  memory; //Memory pointer
+    std::vector<block*> lane_memory; //Pointers to the first block of each lane, which are separate allocations if @segmented
     const uint32_t passes; //Number of passes
     const uint32_t memory_blocks; //Number of blocks in memory
     const uint32_t lanes; //Number of lanes
@@ -109,12 +134,25 @@ struct Argon2_instance_t {
     const uint32_t lane_length; //Value derived from @memory_blocks and @lanes  --- just for cache and readability
     const uint32_t segment_length;  //Value derived from @lane_length and SYNC_POINTS --- just for cache and readability
     uint64_t *Sbox; //S-boxes for Argon2_ds
+    uint64_t *pseudo_rands; //Scratch for the reference block positions of data-independent segments, @segment_length per lane
+    const uint64_t *address_table; //Shared reference block positions of all data-independent segments, NULL if generated per segment
     const bool internal_print; //whether to print the memory blocks to the file - for test vectors only!
-
-    Argon2_instance_t(block* ptr, Argon2_type t, uint32_t p, uint32_t m, uint32_t l, uint32_t thr, bool pr) :
-    memory(ptr),  passes(p), memory_blocks(m), lanes(l),threads(thr), type(t),   lane_length(m / l),
+    bool segmented; //whether every lane is allocated separately, otherwise the lanes are parts of one region
+    bool memory_mapped; //whether the memory was obtained with MapMemory() or MapFile()
+    bool file_backed; //whether the memory is mapped from a backing file
+    bool memory_locked; //whether the memory was locked for this call only
+    bool scratch_mapped; //whether the S-box and the address scratch are mapped on pages of their own, to be locked
+    bool memory_acquired; //whether AcquireMemory() succeeded, so that the hash writes all of the memory
+    std::vector<Argon2_MemoryRegion*> regions; //Memory pool regions holding the memory, if any (one per lane if @segmented)
+    Argon2_Stats *stats; //Time of the phases, NULL if not measured
+    const Argon2_Context *traced; //Context whose @trace_cbk receives the trace records, NULL if not traced
+    uint64_t metered_bytes; //Block memory counted as live in the metrics, given back by FreeMemory()
+
+    Argon2_instance_t(Argon2_type t, uint32_t p, uint32_t m, uint32_t l, uint32_t thr, bool pr) :
+    passes(p), memory_blocks(m), lanes(l),threads(thr), type(t),   lane_length(m / l),
     segment_length(m / (l*ARGON2_SYNC_POINTS)),
-     Sbox(NULL), internal_print(pr) {
+     Sbox(NULL), pseudo_rands(NULL), address_table(NULL), internal_print(pr), segmented(false), memory_mapped(false), file_backed(false),
+     memory_locked(false), scratch_mapped(false), memory_acquired(false), stats(NULL), traced(NULL), metered_bytes(0) {
     };
 };
 
@@ -148,11 +186,93 @@ struct Argon2_position_t {
  */
 int AllocateMemory(block **memory, uint32_t m_cost);
 
-/* Deallocates memory
+/* Obtains the memory for the instance as the context requests, together with the S-box and the address scratch
  * @param instance pointer to the current instance
- * @param clear_memory indicates if we clear the memory with zeros.
+ * @param context pointer to the current context
+ * @return ARGON2_OK if the memory is allocated (and locked if requested), otherwise nothing stays allocated
+ */
+int AcquireMemory(Argon2_instance_t* instance, const Argon2_Context* context);
+
+/* Clears the memory if requested and deallocates it (or returns it to the pool)
+ * @param instance pointer to the current instance
+ * @param context pointer to the current context
+ */
+void FreeMemory(Argon2_instance_t* instance, const Argon2_Context* context);
+
+/* Locks memory in RAM
+ * @param memory pointer to the memory
+ * @param bytes memory size in bytes
+ * @return ARGON2_OK if locked, ARGON2_MEMORY_LOCK_ERROR otherwise
+ */
+int LockMemory(void *memory, size_t bytes);
+
+/* Unlocks memory locked with LockMemory()
+ * @param memory pointer to the memory
+ * @param bytes memory size in bytes
+ */
+void UnlockMemory(void *memory, size_t bytes);
+
+/* Takes a free region of at least @blocks blocks from the pool, or maps a new one
+ * @param pool pointer to the pool
+ * @param blocks number of blocks needed
+ * @return Pointer to the region, NULL if a new region can not be mapped
+ */
+Argon2_MemoryRegion* AcquireRegion(Argon2_MemoryPool* pool, uint32_t blocks);
+
+/* Gives a region back to the pool
+ * @param pool pointer to the pool
+ * @param region pointer to the region obtained with AcquireRegion()
+ */
+void ReleaseRegion(Argon2_MemoryPool* pool, Argon2_MemoryRegion* region);
+
+/*
+ * Updates of the process-wide metrics, see Argon2_Metrics. Lock-free, callable from any thread
+ */
+void MetricsHashStarted(Argon2_type type); //unknown types count in ARGON2_METRICS_UNKNOWN_TYPE
+void MetricsHashFinished(Argon2_type type, int result);
+void MetricsMemory(int64_t bytes); //change of the live block memory
+void MetricsPool(bool hit);
+void MetricsJobs(uint32_t queued, uint32_t taken);
+void MetricsSharedAddressTable(); //a batch entry is verified with the address table of its group
+void MetricsThreadsStarted(uint32_t threads);
+void MetricsTime(uint64_t setup_ns, uint64_t fill_ns, uint64_t finalize_ns);
+
+/* Allocates memory with an anonymous private mapping
+ * @param memory pointer to the pointer to the memory
+ * @param m_cost number of blocks to map
+ * @return ARGON2_OK if @memory is a valid pointer and memory is mapped
+ */
+int MapMemory(block **memory, uint32_t m_cost);
+
+/* Maps memory from a new unnamed file in a directory: opened with O_TMPFILE, or created with mkstemp() and
+ * immediately unlinked. No existing file is opened, truncated or removed
+ * @param memory pointer to the pointer to the memory
+ * @param m_cost number of blocks to map
+ * @param directory directory of the backing file
+ * @return ARGON2_OK if @memory is a valid pointer and memory is mapped
+ */
+int MapFile(block **memory, uint32_t m_cost, const char *directory);
+
+/* Unmaps memory obtained with MapMemory() or MapFile()
+ * @param memory pointer to the memory
+ * @param m_cost number of mapped blocks
+ */
+void UnmapMemory(block *memory, uint32_t m_cost);
+
+/*
+ * Function zeroes the lanes assigned to a worker, bypassing the cache where possible
+ * @param instance Pointer to the current instance
+ * @param worker Index of the worker, it wipes lanes @a worker, @a worker + @a workers, ...
+ * @param workers Total number of workers
+ */
+void WipeLanes(const Argon2_instance_t* instance, uint32_t worker, uint32_t workers);
+
+/*
+ * Function clears the memory (and the S-box) if requested
+ * @param instance Pointer to the current instance
+ * @param context Pointer to current Argon2 context, @a clear_memory and @a discard_memory are used
  */
-void FreeMemory(Argon2_instance_t* instance, bool clear_memory);
+void ClearMemory(Argon2_instance_t* instance, const Argon2_Context* context);
 
 /*
  * Generate pseudo-random values to reference blocks in the segment and puts them into the array
@@ -163,6 +283,24 @@ void FreeMemory(Argon2_instance_t* instance, bool clear_memory);
  */
 void GenerateAddresses(const Argon2_instance_t* instance, const Argon2_position_t* position, uint64_t* pseudo_rands);
 
+/*
+ * Pseudo-random values of a data-independent segment: taken from the address table if the instance has one,
+ * otherwise generated into the lane's part of the scratch
+ * @param instance Pointer to the current instance
+ * @param position Pointer to the current position
+ * @return Pointer to @a instance->segment_length values
+ */
+const uint64_t* SegmentAddresses(const Argon2_instance_t* instance, const Argon2_position_t* position);
+
+/*
+ * Generates the pseudo-random values of all data-independent segments of a context. They depend only on the type
+ * and the cost parameters, so every context with the same ones can share the table, see Argon2Core()
+ * @param context Pointer to the Argon2 context, only the cost parameters are used
+ * @param type Argon2 type
+ * @return The table, empty for the types without data-independent segments
+ */
+std::vector<uint64_t> AddressTable(const Argon2_Context* context, Argon2_type type);
+
 /*
  * Computes absolute position of reference block in the lane following a skewed distribution and using a pseudo-random value as input
  * @param instance Pointer to the current instance
@@ -173,6 +311,17 @@ void GenerateAddresses(const Argon2_instance_t* instance, const Argon2_position_
  */
 uint32_t IndexAlpha(const Argon2_instance_t* instance, const Argon2_position_t* position, uint32_t pseudo_rand, bool same_lane);
 
+/*
+ * Asks the kernel to read ahead the reference blocks of a data-independent segment from the backing file
+ * @param instance Pointer to the current instance
+ * @param position Current position, the index is ignored
+ * @param pseudo_rands Pseudo-random values of the segment generated by GenerateAddresses()
+ * @param begin First index in the segment whose reference block is requested
+ * @param end Index past the last requested one, clipped to the segment length
+ */
+void PrefetchReferenceBlocks(const Argon2_instance_t* instance, Argon2_position_t position, const uint64_t* pseudo_rands,
+        uint32_t begin, uint32_t end);
+
 /*
  * Function that validates all inputs against predefined restrictions and return an error code
  * @param context Pointer to current Argon2 context
@@ -187,7 +336,23 @@ int ValidateInputs(const Argon2_Context* context);
  * @param  type Argon2 type
  * @pre    @a blockhash must have at least @a PREHASH_DIGEST_LENGTH bytes allocated
  */
-void InitialHash(uint8_t* blockhash, const Argon2_Context* context, Argon2_type type);
+void InitialHash(uint8_t* blockhash, Argon2_Context* context, Argon2_type type);
+
+/*
+ * Number of bytes InitialHash() absorbs for the given context
+ * @param  context  Pointer to the Argon2 internal structure containing the inputs
+ */
+size_t InitialHashInputLength(const Argon2_Context* context);
+
+/*
+ * Writes the bytes absorbed by InitialHash() into @a input, so that several contexts can be pre-hashed by one
+ * multi-buffer BLAKE2b call. Clears password and secret if needed, as InitialHash() does
+ * @param  input  Buffer for the serialized inputs
+ * @param  context  Pointer to the Argon2 internal structure containing the inputs
+ * @param  type Argon2 type
+ * @pre    @a input must have at least InitialHashInputLength(@a context) bytes allocated
+ */
+void InitialHashInput(uint8_t* input, Argon2_Context* context, Argon2_type type);
 
 /*
  * Function creates first 2 blocks per lane
@@ -197,6 +362,35 @@ void InitialHash(uint8_t* blockhash, const Argon2_Context* context, Argon2_type
  */
 void FillFirstBlocks(uint8_t* blockhash, const Argon2_instance_t* instance);
 
+/*
+ * Function creates first 2 blocks per lane for several instances, hashing blocks of different lanes and instances together
+ * @param blockhashes Pointers to the pre-hashing digest of each instance
+ * @param instances Pointers to the instances
+ * @param count Number of instances
+ * @pre every blockhash must point to @a PREHASH_SEED_LENGTH allocated values
+ */
+void FillFirstBlocksBatch(uint8_t* const* blockhashes, const Argon2_instance_t* const* instances, uint32_t count);
+
+
+/*
+ * Function faults in the memory pages of the lanes assigned to a worker by writing one word per page.
+ * The first two blocks of every lane are skipped as they are concurrently filled by FillFirstBlocks()
+ * @param instance Pointer to the current instance
+ * @param worker Index of the worker, it touches lanes @a worker, @a worker + @a workers, ...
+ * @param workers Total number of workers
+ * @pre instance->lane_memory must point to the allocated (not yet filled) memory
+ */
+void PrefaultLanes(const Argon2_instance_t* instance, uint32_t worker, uint32_t workers);
+
+/*
+ * Starts the output of a stream: the stream will produce blake2b_long(@a outlen, @a in)
+ * @param stream Pointer to the stream
+ * @param outlen Tag length in bytes
+ * @param in Pointer to the final block
+ * @param inlen Length of the final block in bytes
+ * @return ARGON2_OK if successful
+ */
+int OpenOutputStream(Argon2_OutputStream* stream, uint32_t outlen, const uint8_t* in, uint32_t inlen);
 
 /*
  * Function allocates memory, hashes the inputs with Blake,  and creates first two blocks. Returns the pointer to the main memory with 2 blocks per lane
@@ -211,8 +405,8 @@ int Initialize(Argon2_instance_t* instance, Argon2_Context* context);
  * XORing the last block of each lane, hashing it, making the tag. Deallocates the memory.
  * @param context Pointer to current Argon2 context (use only the out parameters from it)
  * @param instance Pointer to current instance of Argon2
- * @pre instance->memory must point to necessary amount of memory
- * @pre context->out must point to outlen bytes of memory
+ * @pre instance->lane_memory must point to necessary amount of memory
+ * @pre context->out must point to outlen bytes of memory, unless context->output_stream is set
  * @pre if context->free_cbk is not NULL, it should point to a function that deallocates memory
  */
 void Finalize(const Argon2_Context *context, Argon2_instance_t* instance);
@@ -246,9 +440,32 @@ void FillMemoryBlocks(const Argon2_instance_t* instance);
 /*
  * Function that performs memory-hard hashing with certain degree of parallelism
  * @param  context  Pointer to the Argon2 internal structure
+ * @param  type  Argon2 type
+ * @param  address_table  If not NULL, the AddressTable() of a context with the same type and costs
  * @return Error code if smth is wrong, ARGON2_OK otherwise
  */
-int Argon2Core(Argon2_Context* context, Argon2_type type);
+int Argon2Core(Argon2_Context* context, Argon2_type type, const uint64_t* address_table = NULL);
+
+/*
+ * Computes the tag of a context into internal scratch and compares it with @a hash in constant time, see Verify()
+ * @param  context  Pointer to the Argon2 context, @out is not used
+ * @param  type  Argon2 type
+ * @param  hash  Expected tag of @a context->outlen bytes
+ * @param  address_table  If not NULL, the AddressTable() of a context with the same type and costs
+ * @return ARGON2_OK if the tags match, ARGON2_VERIFY_MISMATCH if they do not, another error code otherwise
+ */
+int VerifyCore(Argon2_Context* context, Argon2_type type, const uint8_t* hash, const uint64_t* address_table);
+
+/*
+ * Hashes several independent contexts with the same Argon2 type. The initial hashes, the first blocks and the final
+ * tags are computed with the multi-buffer BLAKE2b, the memory of each context is filled as by Argon2Core()
+ * @param  contexts  Pointers to the Argon2 internal structures
+ * @param  count  Number of contexts
+ * @param  type  Argon2 type
+ * @param  results  If not NULL, receives the error code of every context
+ * @return ARGON2_OK if all contexts were hashed, the error code of the first failed context otherwise
+ */
+int Argon2CoreBatch(Argon2_Context** contexts, uint32_t count, Argon2_type type, int* results);
 
 /*
  * Generates the Sbox from the first memory block (must be ready at that time)
@@ -0,0 +1,692 @@
+/*
+ * Argon2 source code package
+ * 
+ * Written by Daniel Dinu and Dmitry Khovratovich, 2015
+ * 
+ * This work is licensed under a Creative Commons CC0 1.0 License/Waiver.
+ * 
+ * You should have received a copy of the CC0 Public Domain Dedication along with
+ * this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "argon2.h"
+#include "argon2-core.h"
+
+
+/* encoding/decoding helpers */
+
+/*
+ * Some macros for constant-time comparisons. These work over values in
+ * the 0..255 range. Returned value is 0x00 on "false", 0xFF on "true".
+ */
+#define EQ(x, y) ((((0U - ((unsigned)(x) ^ (unsigned)(y))) >> 8) & 0xFF) ^ 0xFF)
+#define GT(x, y) ((((unsigned)(y) - (unsigned)(x)) >> 8) & 0xFF)
+#define GE(x, y) (GT(y, x) ^ 0xFF)
+#define LT(x, y) GT(y, x)
+#define LE(x, y) GE(y, x)
+
+/*
+ * Convert value x (0..63) to corresponding Base64 character.
+ */
+static int b64_byte_to_char(unsigned x) {
+    return (LT(x, 26) & (x + 'A')) |
+           (GE(x, 26) & LT(x, 52) & (x + ('a' - 26))) |
+           (GE(x, 52) & LT(x, 62) & (x + ('0' - 52))) | (EQ(x, 62) & '+') |
+           (EQ(x, 63) & '/');
+}
+
+/*
+ * Convert some bytes to Base64. 'dst_len' is the length (in characters)
+ * of the output buffer 'dst'; if that buffer is not large enough to
+ * receive the result (including the terminating 0), then (size_t)-1
+ * is returned. Otherwise, the zero-terminated Base64 string is written
+ * in the buffer, and the output length (counted WITHOUT the terminating
+ * zero) is returned.
+ */
+static size_t to_base64(char *dst, size_t dst_len, const void *src,
+                        size_t src_len) {
+    size_t olen;
+    const unsigned char *buf;
+    unsigned acc, acc_len;
+
+    olen = (src_len / 3) << 2;
+    switch (src_len % 3) {
+    case 2:
+        olen++;
+    /* fall through */
+    case 1:
+        olen += 2;
+        break;
+    }
+    if (dst_len <= olen) {
+        return (size_t)-1;
+    }
+    acc = 0;
+    acc_len = 0;
+    buf = (const unsigned char *)src;
+    while (src_len-- > 0) {
+        acc = (acc << 8) + (*buf++);
+        acc_len += 8;
+        while (acc_len >= 6) {
+            acc_len -= 6;
+            *dst++ = b64_byte_to_char((acc >> acc_len) & 0x3F);
+        }
+    }
+    if (acc_len > 0) {
+        *dst++ = b64_byte_to_char((acc << (6 - acc_len)) & 0x3F);
+    }
+    *dst++ = 0;
+    return olen;
+}
+
+/*
+ * Convert character c to the corresponding 6-bit value. If character c
+ * is not a Base64 character, then 0xFF (255) is returned.
+ */
+static unsigned b64_char_to_byte(int c) {
+    unsigned x;
+
+    x = (GE(c, 'A') & LE(c, 'Z') & (c - 'A')) |
+        (GE(c, 'a') & LE(c, 'z') & (c - ('a' - 26))) |
+        (GE(c, '0') & LE(c, '9') & (c - ('0' - 52))) | (EQ(c, '+') & 62) |
+        (EQ(c, '/') & 63);
+    return x | (EQ(x, 0) & (EQ(c, 'A') ^ 0xFF));
+}
+
+/*
+ * Decode Base64 chars into bytes. The '*dst_len' value must initially
+ * contain the length of the output buffer '*dst'; when the decoding
+ * ends, the actual number of decoded bytes is written back in
+ * '*dst_len'. If 'dst' is NULL, the bytes are only counted.
+ *
+ * Decoding stops when a non-Base64 character is encountered, or when
+ * the output buffer capacity is exceeded. If an error occurred (output
+ * buffer is too small, invalid last characters leading to unprocessed
+ * buffered bits), then NULL is returned; otherwise, the returned value
+ * points to the first non-Base64 character in the source stream, which
+ * may be the terminating zero.
+ */
+static const char *from_base64(void *dst, uint32_t *dst_len, const char *src) {
+    uint32_t len;
+    unsigned char *buf;
+    unsigned acc, acc_len;
+
+    buf = (unsigned char *)dst;
+    len = 0;
+    acc = 0;
+    acc_len = 0;
+    for (;;) {
+        unsigned d;
+
+        d = b64_char_to_byte(*src);
+        if (d == 0xFF) {
+            break;
+        }
+        src++;
+        acc = (acc << 6) + d;
+        acc_len += 6;
+        if (acc_len >= 8) {
+            acc_len -= 8;
+            if (buf == NULL) {
+                len++;
+                continue;
+            }
+            if (len >= *dst_len) {
+                return NULL;
+            }
+            buf[len++] = (acc >> acc_len) & 0xFF;
+        }
+    }
+
+    /*
+     * If the input length is equal to 1 modulo 4 (which is
+     * invalid), then there will remain 6 unprocessed bits;
+     * otherwise, only 0, 2 or 4 bits are buffered. The buffered
+     * bits must also all be zero.
+     */
+    if (acc_len > 4 || (acc & ((1U << acc_len) - 1)) != 0) {
+        return NULL;
+    }
+    *dst_len = len;
+    return src;
+}
+
+/*
+ * Decode decimal integer from 'str'; the value is written in '*v'.
+ * Returned value is a pointer to the next non-decimal character in the
+ * string. If there is no digit at all, or the value encoding is not
+ * minimal (extra leading zeros), or the value does not fit in an
+ * 'uint32_t', then NULL is returned.
+ */
+static const char *decode_decimal(const char *str, uint32_t *v) {
+    const char *orig;
+    uint64_t acc;
+
+    acc = 0;
+    for (orig = str;; str++) {
+        int c;
+
+        c = *str;
+        if (c < '0' || c > '9') {
+            break;
+        }
+        acc = acc * 10 + (unsigned)(c - '0');
+        if (acc > UINT32_MAX) {
+            return NULL;
+        }
+    }
+    if (str == orig || (*orig == '0' && str != (orig + 1))) {
+        return NULL;
+    }
+    *v = (uint32_t)acc;
+    return str;
+}
+
+/* ==================================================================== */
+/*
+ * The code below applies the following format:
+ *
+ *  $argon2<T>[$v=<num>]$m=<num>,t=<num>,p=<num>[,keyid=<bin>][,data=<bin>]$<bin>$<bin>
+ *
+ * where <T> is one of "d", "i", "id" or "ds", <num> is a decimal integer
+ * (fits in an 'uint32_t', no leading zeros) and <bin> is Base64-encoded data
+ * (no '=' padding characters, no newline or whitespace). The "keyid" is a
+ * binary identifier for a key; "data" is the associated data. When the
+ * 'keyid' (resp. the 'data') is empty, then it is omitted from the output.
+ * The version field is not written; when present in the input it must
+ * match ARGON2_VERSION_NUMBER, except for NeedsRehash() which reports
+ * another version as a reason to rehash.
+ *
+ * The last two binary chunks (encoded in Base64) are, in that order,
+ * the salt and the output.
+ */
+
+/*
+ * Name of the type in the encoded string, NULL for an unknown type
+ */
+static const char *type_to_string(Argon2_type type) {
+    switch (type) {
+    case Argon2_d:
+        return "d";
+    case Argon2_i:
+        return "i";
+    case Argon2_id:
+        return "id";
+    case Argon2_ds:
+        return "ds";
+    }
+    return NULL;
+}
+
+int EncodeHash(char *dst, size_t dst_len, const Argon2_EncodedHash *encoded) {
+#define SS(str)                                                                \
+    do {                                                                       \
+        size_t pp_len = strlen(str);                                           \
+        if (pp_len >= dst_len) {                                               \
+            return ARGON2_ENCODING_FAIL;                                       \
+        }                                                                      \
+        memcpy(dst, str, pp_len + 1);                                          \
+        dst += pp_len;                                                         \
+        dst_len -= pp_len;                                                     \
+    } while (0)
+
+#define SX(x)                                                                  \
+    do {                                                                       \
+        char tmp[30];                                                          \
+        sprintf(tmp, "%lu", (unsigned long)(x));                               \
+        SS(tmp);                                                               \
+    } while (0);
+
+#define SB(buf, len)                                                           \
+    do {                                                                       \
+        size_t sb_len = to_base64(dst, dst_len, buf, len);                     \
+        if (sb_len == (size_t)-1) {                                            \
+            return ARGON2_ENCODING_FAIL;                                       \
+        }                                                                      \
+        dst += sb_len;                                                         \
+        dst_len -= sb_len;                                                     \
+    } while (0);
+
+    if (NULL == dst || NULL == encoded) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+    const char *type = type_to_string(encoded->type);
+    if (NULL == type) {
+        return ARGON2_INCORRECT_TYPE;
+    }
+    if ((NULL == encoded->keyid && 0 != encoded->keyidlen) ||
+        (NULL == encoded->data && 0 != encoded->datalen) ||
+        (NULL == encoded->salt && 0 != encoded->saltlen) ||
+        (NULL == encoded->hash && 0 != encoded->hashlen)) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+
+    SS("$argon2");
+    SS(type);
+    SS("$m=");
+    SX(encoded->m_cost);
+    SS(",t=");
+    SX(encoded->t_cost);
+    SS(",p=");
+    SX(encoded->lanes);
+
+    if (encoded->keyidlen > 0) {
+        SS(",keyid=");
+        SB(encoded->keyid, encoded->keyidlen);
+    }
+
+    if (encoded->datalen > 0) {
+        SS(",data=");
+        SB(encoded->data, encoded->datalen);
+    }
+
+    SS("$");
+    SB(encoded->salt, encoded->saltlen);
+
+    SS("$");
+    SB(encoded->hash, encoded->hashlen);
+    return ARGON2_OK;
+
+#undef SS
+#undef SX
+#undef SB
+}
+
+/*
+ * Copies an input of a context, given contiguously or as parts, into @a dst
+ * @return false if it is longer than @a capacity
+ */
+static bool GatherInput(const uint8_t *input, uint32_t length, const Argon2_InputPart *parts, uint32_t count,
+        uint8_t *dst, uint32_t capacity, uint32_t *dst_len) {
+    *dst_len = 0;
+    if (NULL == parts) {
+        if (NULL != input && length > capacity) {
+            return false;
+        }
+        *dst_len = (NULL == input) ? 0 : length;
+        if (0 != *dst_len) {
+            memcpy(dst, input, *dst_len);
+        }
+        return true;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        if (parts[i].length > capacity - *dst_len) {
+            return false;
+        }
+        if (0 != parts[i].length) {
+            memcpy(dst + *dst_len, parts[i].data, parts[i].length);
+        }
+        *dst_len += parts[i].length;
+    }
+    return true;
+}
+
+int EncodeString(char *dst, size_t dst_len, Argon2_type type, const Argon2_Context *context) {
+    if (NULL == context) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+    // Only a string that VerifyEncoded() can check is written: the tag must be in @out, and the fields within the
+    // ARGON2_ENCODED_MAX_* lengths it decodes
+    if (NULL != context->output_stream || NULL == context->out || ARGON2_ENCODED_MAX_HASH_LENGTH < context->outlen) {
+        return ARGON2_ENCODING_FAIL;
+    }
+    uint8_t data[ARGON2_ENCODED_MAX_DATA_LENGTH], salt[ARGON2_ENCODED_MAX_SALT_LENGTH];
+    Argon2_EncodedHash encoded;
+    encoded.type = type;
+    encoded.m_cost = context->m_cost;
+    encoded.t_cost = context->t_cost;
+    encoded.lanes = context->lanes;
+    encoded.keyid = NULL;
+    encoded.keyidlen = 0;
+    encoded.data = data;
+    encoded.salt = salt;
+    if (!GatherInput(context->ad, context->adlen, context->ad_parts, context->ad_parts_count, data, sizeof (data),
+                &encoded.datalen) ||
+            !GatherInput(context->salt, context->saltlen, context->salt_parts, context->salt_parts_count, salt,
+                sizeof (salt), &encoded.saltlen)) {
+        return ARGON2_ENCODING_FAIL;
+    }
+    encoded.hash = context->out;
+    encoded.hashlen = context->outlen;
+    return EncodeHash(dst, dst_len, &encoded);
+}
+
+/*
+ * DecodeHash() of a string of any version
+ * @param version Receives the version, ARGON2_VERSION_NUMBER if the string has none
+ */
+static int DecodeFields(Argon2_EncodedHash *decoded, const char *str, uint32_t *version) {
+/* check for prefix */
+#define CC(prefix)                                                             \
+    do {                                                                       \
+        size_t cc_len = strlen(prefix);                                        \
+        if (strncmp(str, prefix, cc_len) != 0) {                               \
+            return ARGON2_DECODING_FAIL;                                       \
+        }                                                                      \
+        str += cc_len;                                                         \
+    } while ((void)0, 0)
+
+/* optional prefix checking with supplied code */
+#define CC_opt(prefix, code)                                                   \
+    do {                                                                       \
+        size_t cc_len = strlen(prefix);                                        \
+        if (strncmp(str, prefix, cc_len) == 0) {                               \
+            str += cc_len;                                                     \
+            { code; }                                                          \
+        }                                                                      \
+    } while ((void)0, 0)
+
+/* decoding decimal integer */
+#define DECIMAL(x)                                                             \
+    do {                                                                       \
+        str = decode_decimal(str, &(x));                                       \
+        if (str == NULL) {                                                     \
+            return ARGON2_DECODING_FAIL;                                       \
+        }                                                                      \
+    } while ((void)0, 0)
+
+/* decoding Base64 into the caller buffer, whose capacity is given by len */
+#define BIN(buf, len)                                                          \
+    do {                                                                       \
+        str = from_base64((buf), &(len), str);                                 \
+        if (str == NULL) {                                                     \
+            return ARGON2_DECODING_FAIL;                                       \
+        }                                                                      \
+    } while ((void)0, 0)
+
+    if (NULL == decoded || NULL == str) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+
+    const uint32_t keyid_capacity = decoded->keyidlen;
+    const uint32_t data_capacity = decoded->datalen;
+    *version = ARGON2_VERSION_NUMBER;
+
+    decoded->keyidlen = 0;
+    decoded->datalen = 0;
+
+    CC("$argon2");
+    if ('d' == str[0] && '$' == str[1]) {
+        decoded->type = Argon2_d;
+        str += 1;
+    } else if ('i' == str[0] && '$' == str[1]) {
+        decoded->type = Argon2_i;
+        str += 1;
+    } else if ('i' == str[0] && 'd' == str[1] && '$' == str[2]) {
+        decoded->type = Argon2_id;
+        str += 2;
+    } else if ('d' == str[0] && 's' == str[1] && '$' == str[2]) {
+        decoded->type = Argon2_ds;
+        str += 2;
+    } else {
+        return ARGON2_DECODING_FAIL;
+    }
+
+    CC_opt("$v=", DECIMAL(*version));
+    CC("$m=");
+    DECIMAL(decoded->m_cost);
+    CC(",t=");
+    DECIMAL(decoded->t_cost);
+    CC(",p=");
+    DECIMAL(decoded->lanes);
+
+    CC_opt(",keyid=", decoded->keyidlen = keyid_capacity; BIN(decoded->keyid, decoded->keyidlen));
+    CC_opt(",data=", decoded->datalen = data_capacity; BIN(decoded->data, decoded->datalen));
+
+    CC("$");
+    BIN(decoded->salt, decoded->saltlen);
+
+    CC("$");
+    BIN(decoded->hash, decoded->hashlen);
+
+    /* The string has to be over */
+    if (*str != 0) {
+        return ARGON2_DECODING_FAIL;
+    }
+    return ARGON2_OK;
+
+#undef CC
+#undef CC_opt
+#undef DECIMAL
+#undef BIN
+}
+
+int DecodeHash(Argon2_EncodedHash *decoded, const char *str) {
+    uint32_t version;
+    int result = DecodeFields(decoded, str, &version);
+    // The fields of another version can not be hashed by this one
+    if (ARGON2_OK == result && ARGON2_VERSION_NUMBER != version) {
+        result = ARGON2_DECODING_FAIL;
+    }
+    return result;
+}
+
+/*
+ * Decoded hash together with the buffers of its fields, which are bounded by the ARGON2_ENCODED_MAX_* limits
+ */
+struct DecodedEntry {
+    Argon2_EncodedHash decoded; //fields, pointing to the buffers below
+    uint8_t keyid[ARGON2_ENCODED_MAX_KEYID_LENGTH];
+    uint8_t data[ARGON2_ENCODED_MAX_DATA_LENGTH];
+    uint8_t salt[ARGON2_ENCODED_MAX_SALT_LENGTH];
+    uint8_t hash[ARGON2_ENCODED_MAX_HASH_LENGTH];
+};
+
+/*
+ * Decodes a hash to be verified
+ * @return ARGON2_OK, the error of DecodeHash(), or ARGON2_SECRET_REQUIRED if the hash is keyed: the secret of its key
+ * id is not known here, so any password would mismatch
+ */
+static int DecodeEntry(DecodedEntry *entry, const char *encoded) {
+    entry->decoded.keyid = entry->keyid;
+    entry->decoded.keyidlen = sizeof (entry->keyid);
+    entry->decoded.data = entry->data;
+    entry->decoded.datalen = sizeof (entry->data);
+    entry->decoded.salt = entry->salt;
+    entry->decoded.saltlen = sizeof (entry->salt);
+    entry->decoded.hash = entry->hash;
+    entry->decoded.hashlen = sizeof (entry->hash);
+    int result = DecodeHash(&entry->decoded, encoded);
+    if (ARGON2_OK == result && 0 != entry->decoded.keyidlen) {
+        result = ARGON2_SECRET_REQUIRED;
+    }
+    return result;
+}
+
+/*
+ * Context that recomputes the tag of a decoded entry for the given password
+ */
+static Argon2_Context EntryContext(DecodedEntry *entry, const uint8_t *pwd, uint32_t pwdlen, uint32_t threads) {
+    // Keyed hashes are rejected by DecodeEntry(), so there is no secret
+    return Argon2_Context(NULL, entry->decoded.hashlen,
+            (uint8_t*) pwd, pwdlen,
+            entry->decoded.salt, entry->decoded.saltlen,
+            NULL, 0,
+            entry->decoded.data, entry->decoded.datalen,
+            entry->decoded.t_cost, entry->decoded.m_cost, entry->decoded.lanes, threads,
+            NULL, NULL, false, false, false, false);
+}
+
+int VerifyEncoded(const char *encoded, const uint8_t *pwd, uint32_t pwdlen) {
+    DecodedEntry entry;
+    int result = DecodeEntry(&entry, encoded);
+    if (ARGON2_OK != result) {
+        return result;
+    }
+
+    Argon2_Context context = EntryContext(&entry, pwd, pwdlen, entry.decoded.lanes);
+    return Verify(entry.decoded.type, &context, entry.decoded.hash);
+}
+
+/*
+ * Work shared by the workers of VerifyEncodedBatch()
+ */
+struct VerifyBatch {
+    std::vector<DecodedEntry> entries; //decoded hashes
+    std::vector<const uint64_t*> address_tables; //address table of every entry, NULL if it has none
+    std::vector<uint32_t> order; //indices of the decoded entries, grouped by parameters
+    std::atomic<uint32_t> next; //position in @order of the next entry to verify
+    const uint8_t *const *pwds;
+    const uint32_t *pwdlens;
+    Argon2_MemoryPool *pool;
+    std::vector<int> status; //result of every entry
+};
+
+static void VerifyBatchWorker(VerifyBatch *batch) {
+    for (uint32_t i = batch->next++; i < batch->order.size(); i = batch->next++) {
+        const uint32_t k = batch->order[i];
+        MetricsJobs(0, 1);
+        if (NULL != batch->address_tables[k]) {
+            MetricsSharedAddressTable();
+        }
+        // Entries are spread over the workers, every one of them is hashed by a single thread
+        Argon2_Context context = EntryContext(&batch->entries[k], batch->pwds[k], batch->pwdlens[k], 1);
+        context.memory_pool = batch->pool;
+        batch->status[k] = VerifyCore(&context, batch->entries[k].decoded.type, batch->entries[k].decoded.hash,
+                batch->address_tables[k]);
+    }
+}
+
+/*
+ * Whether an address table can be computed for @a decoded: a data-independent type and the costs that
+ * ValidateInputs() accepts. The other inputs do not affect the table and are validated by every entry's own call
+ */
+static bool AddressTableParameters(const Argon2_EncodedHash &decoded) {
+    return (Argon2_i == decoded.type || Argon2_id == decoded.type) &&
+            ARGON2_MIN_MEMORY <= decoded.m_cost && ARGON2_MAX_MEMORY >= decoded.m_cost &&
+            ARGON2_MIN_TIME <= decoded.t_cost && ARGON2_MAX_TIME >= decoded.t_cost &&
+            ARGON2_MIN_LANES <= decoded.lanes && ARGON2_MAX_LANES >= decoded.lanes;
+}
+
+static bool SameParameters(const Argon2_EncodedHash &a, const Argon2_EncodedHash &b) {
+    return a.type == b.type && a.m_cost == b.m_cost && a.t_cost == b.t_cost && a.lanes == b.lanes;
+}
+
+int VerifyEncodedBatch(const char *const *encoded, const uint8_t *const *pwds, const uint32_t *pwdlens, uint32_t count,
+        uint32_t threads, Argon2_MemoryPool *pool, int *results) {
+    if ((NULL == encoded || NULL == pwds || NULL == pwdlens) && count > 0) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+    if (ARGON2_MIN_THREADS > threads) {
+        return ARGON2_THREADS_TOO_FEW;
+    }
+    if (ARGON2_MAX_THREADS < threads) {
+        return ARGON2_THREADS_TOO_MANY;
+    }
+
+    VerifyBatch batch;
+    batch.entries.resize(count);
+    batch.address_tables.assign(count, NULL);
+    batch.status.assign(count, ARGON2_OK);
+    batch.next = 0;
+    batch.pwds = pwds;
+    batch.pwdlens = pwdlens;
+    for (uint32_t k = 0; k < count; ++k) {
+        batch.status[k] = DecodeEntry(&batch.entries[k], encoded[k]);
+        if (ARGON2_OK == batch.status[k]) {
+            batch.order.push_back(k);
+        }
+    }
+
+    // Entries with the same parameters are verified one after another, so that they reuse the pool regions of one size
+    const std::vector<DecodedEntry> &entries = batch.entries;
+    std::stable_sort(batch.order.begin(), batch.order.end(), [&entries](uint32_t a, uint32_t b) {
+        const Argon2_EncodedHash &x = entries[a].decoded, &y = entries[b].decoded;
+        return std::tie(x.type, x.m_cost, x.t_cost, x.lanes) < std::tie(y.type, y.m_cost, y.t_cost, y.lanes);
+    });
+
+    // The reference block positions of data-independent segments depend only on the parameters, so a group
+    // computes them once. Above ARGON2_ADDRESSES_IN_BLOCK passes the table of Argon2i outgrows the memory of a hash
+    std::vector<std::vector<uint64_t>> tables;
+    for (size_t begin = 0, end = 0; begin < batch.order.size(); begin = end) {
+        DecodedEntry *first = &batch.entries[batch.order[begin]];
+        for (end = begin + 1; end < batch.order.size() &&
+                SameParameters(first->decoded, batch.entries[batch.order[end]].decoded); ++end) {
+        }
+        if (end - begin < 2 || first->decoded.t_cost > ARGON2_ADDRESSES_IN_BLOCK ||
+                !AddressTableParameters(first->decoded)) {
+            continue;
+        }
+        Argon2_Context context = EntryContext(first, NULL, 0, 1);
+        tables.push_back(AddressTable(&context, first->decoded.type));
+        for (size_t i = begin; i < end && !tables.back().empty(); ++i) {
+            batch.address_tables[batch.order[i]] = tables.back().data();
+        }
+    }
+
+    batch.pool = (NULL != pool) ? pool : CreateMemoryPool();
+    if (NULL == batch.pool) {
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+    const uint32_t workers = (uint32_t) ARGON2_MIN((size_t) threads, batch.order.size());
+    MetricsJobs((uint32_t) batch.order.size(), 0);
+    if (workers <= 1) { // no concurrency to gain, save the thread creation
+        VerifyBatchWorker(&batch);
+    } else {
+        std::vector<std::thread> Threads;
+        for (uint32_t w = 0; w < workers; ++w) {
+            Threads.push_back(std::thread(VerifyBatchWorker, &batch));
+        }
+        MetricsThreadsStarted(workers);
+        for (auto& t : Threads) {
+            t.join();
+        }
+    }
+    if (NULL == pool) {
+        DestroyMemoryPool(batch.pool);
+    }
+
+    int result = ARGON2_OK;
+    for (uint32_t k = 0; k < count; ++k) {
+        if (NULL != results) {
+            results[k] = batch.status[k];
+        }
+        if (ARGON2_OK == result) {
+            result = batch.status[k];
+        }
+    }
+    return result;
+}
+
+int NeedsRehash(const char *encoded, const Argon2_RehashPolicy *policy, bool *needs_rehash) {
+    if (NULL == policy || NULL == needs_rehash) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+
+    // NULL buffers: the fields are only measured, nothing is copied
+    Argon2_EncodedHash decoded;
+    decoded.keyid = NULL;
+    decoded.keyidlen = 0;
+    decoded.data = NULL;
+    decoded.datalen = 0;
+    decoded.salt = NULL;
+    decoded.saltlen = 0;
+    decoded.hash = NULL;
+    decoded.hashlen = 0;
+
+    uint32_t version;
+    int result = DecodeFields(&decoded, encoded, &version);
+    if (ARGON2_OK != result) {
+        return result;
+    }
+
+    // A hash of another version is well-formed, it only can not be verified any more
+    *needs_rehash = version != ARGON2_VERSION_NUMBER ||
+            decoded.type != policy->type ||
+            decoded.lanes != policy->lanes ||
+            decoded.m_cost < policy->m_cost ||
+            decoded.t_cost < policy->t_cost ||
+            decoded.hashlen < policy->outlen ||
+            decoded.saltlen < policy->saltlen;
+    return ARGON2_OK;
+}
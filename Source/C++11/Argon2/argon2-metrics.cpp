@@ -0,0 +1,219 @@
+/*
+ * Argon2 source code package
+ *
+ * Written by Daniel Dinu and Dmitry Khovratovich, 2015
+ *
+ * This work is licensed under a Creative Commons CC0 1.0 License/Waiver.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along with
+ * this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <cstring>
+#include <atomic>
+
+#include "argon2.h"
+#include "argon2-core.h"
+
+
+/* Number of shards, threads beyond it share them */
+const uint32_t METRICS_SHARDS = 64;
+
+/*
+ * Counters of the threads mapped to one shard. A cache line of its own, so that threads of different shards do not
+ * contend on the same line
+ */
+struct alignas(64) MetricsShard {
+    std::atomic<uint64_t> hashes_started[ARGON2_METRICS_TYPES];
+    std::atomic<uint64_t> hashes_completed[ARGON2_METRICS_TYPES];
+    std::atomic<uint64_t> hashes_failed[ARGON2_METRICS_TYPES];
+    std::atomic<uint64_t> pool_hits;
+    std::atomic<uint64_t> pool_misses;
+    std::atomic<uint64_t> jobs_queued; //the gauge is @jobs_queued - @jobs_taken over all shards
+    std::atomic<uint64_t> jobs_taken;
+    std::atomic<uint64_t> shared_address_tables;
+    std::atomic<uint64_t> threads_started;
+    std::atomic<uint64_t> setup_ns;
+    std::atomic<uint64_t> fill_ns;
+    std::atomic<uint64_t> finalize_ns;
+};
+
+/* Zero-initialized as objects of static storage duration */
+static MetricsShard shards[METRICS_SHARDS];
+static std::atomic<uint32_t> next_shard;
+
+/*
+ * The peak needs the sum at every change, so the live memory is one counter. It changes once per allocation and
+ * release of a call, not per block
+ */
+static std::atomic<uint64_t> memory_live;
+static std::atomic<uint64_t> memory_peak;
+
+/*
+ * Shard of the calling thread, assigned round-robin on its first update
+ */
+static MetricsShard& LocalShard() {
+    static thread_local uint32_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % METRICS_SHARDS;
+    return shards[shard];
+}
+
+static void Add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+}
+
+/*
+ * Entry of the per-type counters of @a type, ARGON2_METRICS_UNKNOWN_TYPE if it is not an Argon2 type
+ */
+static uint32_t TypeIndex(Argon2_type type) {
+    return (Argon2_d == type || Argon2_i == type || Argon2_id == type || Argon2_ds == type) ? (uint32_t) type
+                                                                                          : ARGON2_METRICS_UNKNOWN_TYPE;
+}
+
+void MetricsHashStarted(Argon2_type type) {
+    Add(LocalShard().hashes_started[TypeIndex(type)], 1);
+}
+
+void MetricsHashFinished(Argon2_type type, int result) {
+    const uint32_t t = TypeIndex(type);
+    Add((ARGON2_OK == result) ? LocalShard().hashes_completed[t] : LocalShard().hashes_failed[t], 1);
+}
+
+void MetricsMemory(int64_t bytes) {
+    const uint64_t live = memory_live.fetch_add((uint64_t) bytes, std::memory_order_relaxed) + (uint64_t) bytes;
+    uint64_t peak = memory_peak.load(std::memory_order_relaxed);
+    while (bytes > 0 && live > peak && !memory_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+void MetricsPool(bool hit) {
+    Add(hit ? LocalShard().pool_hits : LocalShard().pool_misses, 1);
+}
+
+void MetricsJobs(uint32_t queued, uint32_t taken) {
+    MetricsShard& shard = LocalShard();
+    Add(shard.jobs_queued, queued);
+    Add(shard.jobs_taken, taken);
+}
+
+void MetricsSharedAddressTable() {
+    Add(LocalShard().shared_address_tables, 1);
+}
+
+void MetricsThreadsStarted(uint32_t threads) {
+    Add(LocalShard().threads_started, threads);
+}
+
+void MetricsTime(uint64_t setup_ns, uint64_t fill_ns, uint64_t finalize_ns) {
+    MetricsShard& shard = LocalShard();
+    Add(shard.setup_ns, setup_ns);
+    Add(shard.fill_ns, fill_ns);
+    Add(shard.finalize_ns, finalize_ns);
+}
+
+void GetMetrics(Argon2_Metrics *metrics) {
+    if (NULL == metrics) {
+        return;
+    }
+    memset(metrics, 0, sizeof (*metrics));
+    uint64_t jobs_queued = 0, jobs_taken = 0;
+    for (const MetricsShard& shard : shards) {
+        for (uint32_t t = 0; t < ARGON2_METRICS_TYPES; ++t) {
+            metrics->hashes_started[t] += shard.hashes_started[t].load(std::memory_order_relaxed);
+            metrics->hashes_completed[t] += shard.hashes_completed[t].load(std::memory_order_relaxed);
+            metrics->hashes_failed[t] += shard.hashes_failed[t].load(std::memory_order_relaxed);
+        }
+        metrics->pool_hits += shard.pool_hits.load(std::memory_order_relaxed);
+        metrics->pool_misses += shard.pool_misses.load(std::memory_order_relaxed);
+        jobs_queued += shard.jobs_queued.load(std::memory_order_relaxed);
+        jobs_taken += shard.jobs_taken.load(std::memory_order_relaxed);
+        metrics->shared_address_tables += shard.shared_address_tables.load(std::memory_order_relaxed);
+        metrics->threads_started += shard.threads_started.load(std::memory_order_relaxed);
+        metrics->setup_ns += shard.setup_ns.load(std::memory_order_relaxed);
+        metrics->fill_ns += shard.fill_ns.load(std::memory_order_relaxed);
+        metrics->finalize_ns += shard.finalize_ns.load(std::memory_order_relaxed);
+    }
+    // A job may be counted as taken in a shard summed before the shard that counted it as queued
+    metrics->queued_jobs = (jobs_queued > jobs_taken) ? jobs_queued - jobs_taken : 0;
+    metrics->memory_live_bytes = memory_live.load(std::memory_order_relaxed);
+    metrics->memory_peak_bytes = memory_peak.load(std::memory_order_relaxed);
+}
+
+/*
+ * Appends to the text being formatted, remembers if it did not fit
+ */
+struct MetricsText {
+    char *dst;
+    size_t dst_len;
+    size_t length; //bytes written, without the terminating zero
+    bool overflow;
+
+    void Append(const char *format, ...) {
+        if (overflow) {
+            return;
+        }
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(dst + length, dst_len - length, format, args);
+        va_end(args);
+        if (written < 0 || (size_t) written >= dst_len - length) {
+            overflow = true;
+        } else {
+            length += (size_t) written;
+        }
+    }
+
+    void Family(const char *name, const char *type, const char *help) {
+        Append("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    }
+
+    void PerType(const char *name, const char *help, const uint64_t *values) {
+        static const char *const TYPE_LABELS[ARGON2_METRICS_TYPES] = {
+            "argon2d", "argon2i", "argon2id", "unknown", "argon2ds"
+        };
+        Family(name, "counter", help);
+        for (uint32_t t = 0; t < ARGON2_METRICS_TYPES; ++t) {
+            Append("%s{type=\"%s\"} %llu\n", name, TYPE_LABELS[t], (unsigned long long) values[t]);
+        }
+    }
+
+    void Value(const char *name, const char *type, const char *help, uint64_t value) {
+        Family(name, type, help);
+        Append("%s %llu\n", name, (unsigned long long) value);
+    }
+
+    void Seconds(const char *name, const char *help, uint64_t ns) {
+        Family(name, "counter", help);
+        Append("%s %llu.%09llu\n", name, (unsigned long long) (ns / 1000000000), (unsigned long long) (ns % 1000000000));
+    }
+};
+
+int FormatMetrics(char *dst, size_t dst_len, const Argon2_Metrics *metrics) {
+    if (NULL == dst || 0 == dst_len || NULL == metrics) {
+        return ARGON2_ENCODING_FAIL;
+    }
+    MetricsText text = {dst, dst_len, 0, false};
+    dst[0] = 0;
+    text.PerType("argon2_hashes_started_total", "Hash calls started.", metrics->hashes_started);
+    text.PerType("argon2_hashes_completed_total", "Hash calls that succeeded.", metrics->hashes_completed);
+    text.PerType("argon2_hashes_failed_total", "Hash calls that returned an error.", metrics->hashes_failed);
+    text.Value("argon2_memory_live_bytes", "gauge", "Block memory held by running calls.", metrics->memory_live_bytes);
+    text.Value("argon2_memory_peak_bytes", "gauge", "Highest block memory held at once.", metrics->memory_peak_bytes);
+    text.Value("argon2_pool_hits_total", "counter", "Memory pool regions reused.", metrics->pool_hits);
+    text.Value("argon2_pool_misses_total", "counter", "Memory pool regions newly mapped.", metrics->pool_misses);
+    text.Value("argon2_queued_jobs", "gauge", "Batch verify entries waiting for a worker.", metrics->queued_jobs);
+    text.Value("argon2_verify_shared_address_tables_total", "counter",
+            "Batch verify entries that used the address table of their group.", metrics->shared_address_tables);
+    text.Value("argon2_threads_started_total", "counter", "Segment and worker threads created.", metrics->threads_started);
+    text.Seconds("argon2_setup_seconds_total", "Time in validation, allocation and the first blocks.", metrics->setup_ns);
+    text.Seconds("argon2_fill_seconds_total", "Time filling the memory.", metrics->fill_ns);
+    text.Seconds("argon2_finalize_seconds_total", "Time computing the tag and releasing the memory.", metrics->finalize_ns);
+    if (text.overflow) {
+        dst[0] = 0;
+        return ARGON2_ENCODING_FAIL;
+    }
+    return ARGON2_OK;
+}
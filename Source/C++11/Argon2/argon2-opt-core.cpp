@@ -36,6 +36,7 @@
 
 /* The KAT file name */
 const char* ARGON2_KAT_FILENAME = "kat-argon2-opt.log";
+const char* ARGON2_IMPLEMENTATION = "opt";
 
 
 //const __m128i r16 = _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
@@ -97,6 +98,12 @@ void FillBlock(__m128i* state, const uint8_t *ref_block, uint8_t *next_block, co
     }
 }
 
+void FillBlock(const block* prev_block, const block* ref_block, block* next_block, const uint64_t* Sbox) {
+    __m128i state[ARGON2_QWORDS_IN_BLOCK];
+    memcpy(state, prev_block->v, ARGON2_BLOCK_SIZE);
+    FillBlock(state, (const uint8_t *) ref_block->v, (uint8_t *) next_block->v, Sbox);
+}
+
 void GenerateAddresses(const Argon2_instance_t* instance, const Argon2_position_t* position, uint64_t* pseudo_rands) {
     block input_block(0), address_block(0);
     if (instance != NULL && position != NULL) {
@@ -135,13 +142,10 @@ void FillSegment(const Argon2_instance_t* instance, Argon2_position_t position)
 	bool data_independent_addressing = (instance->type == Argon2_i) || (instance->type == Argon2_id && (position.pass == 0) && (position.slice < ARGON2_SYNC_POINTS / 2));
 
     
-   // Pseudo-random values that determine the reference block position
-   uint64_t *pseudo_rands = new uint64_t[instance->segment_length];
-   if (pseudo_rands == NULL) {
-		return;
-	}
+   // Pseudo-random values that determine the reference block position, from the address table or the lane's scratch
+   const uint64_t *pseudo_rands = NULL;
    if (data_independent_addressing) {
-       GenerateAddresses(instance, &position, pseudo_rands);
+       pseudo_rands = SegmentAddresses(instance, &position);
    }
 
    uint32_t starting_index = 0;
@@ -149,28 +153,37 @@ void FillSegment(const Argon2_instance_t* instance, Argon2_position_t position)
        starting_index = 2; // we have already generated the first two blocks
    }
 
-   // Offset of the current block
-   curr_offset = position.lane * instance->lane_length + position.slice * instance->segment_length + starting_index;
-   if (0 == curr_offset % instance->lane_length) {
+   if (data_independent_addressing && instance->file_backed) {
+       PrefetchReferenceBlocks(instance, position, pseudo_rands, starting_index, 2 * ARGON2_PREFETCH_WINDOW);
+   }
+
+   // Offset of the current block within the lane
+   block* lane = instance->lane_memory[position.lane];
+   curr_offset = position.slice * instance->segment_length + starting_index;
+   if (0 == curr_offset) {
        // Last block in this lane
        prev_offset = curr_offset + instance->lane_length - 1;
    } else {
        // Previous block
        prev_offset = curr_offset - 1;
    }
-   memcpy(state, (uint8_t *) ((instance->memory + prev_offset)->v), ARGON2_BLOCK_SIZE);
+   memcpy(state, (uint8_t *) ((lane + prev_offset)->v), ARGON2_BLOCK_SIZE);
    for (uint32_t i = starting_index; i < instance->segment_length; ++i, ++curr_offset, ++prev_offset) {
        /*1.1 Rotating prev_offset if needed */
-       if (curr_offset % instance->lane_length == 1) {
+       if (curr_offset == 1) {
            prev_offset = curr_offset - 1;
        }
 
        /* 1.2 Computing the index of the reference block */
        /* 1.2.1 Taking pseudo-random value from the previous block */
        if (data_independent_addressing) {
+           if (instance->file_backed && i != 0 && (i % ARGON2_PREFETCH_WINDOW) == 0) {
+               // Reading ahead the next window, the blocks of the current one are already requested
+               PrefetchReferenceBlocks(instance, position, pseudo_rands, i + ARGON2_PREFETCH_WINDOW, i + 2 * ARGON2_PREFETCH_WINDOW);
+           }
            pseudo_rand = pseudo_rands[i];
        } else {
-           pseudo_rand = instance->memory[prev_offset][0];
+           pseudo_rand = lane[prev_offset][0];
        }
 
        /* 1.2.2 Computing the lane of the reference block */
@@ -185,20 +198,17 @@ void FillSegment(const Argon2_instance_t* instance, Argon2_position_t position)
        ref_index = IndexAlpha(instance, &position, pseudo_rand & 0xFFFFFFFF, ref_lane == position.lane);
 
        /* 2 Creating a new block */
-       block* ref_block = instance->memory + instance->lane_length * ref_lane + ref_index;
-       block* curr_block = instance->memory + curr_offset;
+       block* ref_block = instance->lane_memory[ref_lane] + ref_index;
+       block* curr_block = lane + curr_offset;
        FillBlock(state, (uint8_t *) ref_block->v, (uint8_t *) curr_block->v, instance->Sbox);
    }
-
-   delete[] pseudo_rands;
-   
 }
 
 void GenerateSbox(Argon2_instance_t* instance) {
     if (instance == NULL) {
         return;
     }
-    block start_block(instance->memory[0]), out_block(0), zero_block(0);
+    block start_block(instance->lane_memory[0][0]), out_block(0), zero_block(0);
     
     if (instance->Sbox == NULL) {
         instance->Sbox = new uint64_t[ARGON2_SBOX_SIZE];
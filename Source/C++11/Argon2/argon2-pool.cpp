@@ -0,0 +1,76 @@
+/*
+ * Argon2 source code package
+ * 
+ * Written by Daniel Dinu and Dmitry Khovratovich, 2015
+ * 
+ * This work is licensed under a Creative Commons CC0 1.0 License/Waiver.
+ * 
+ * You should have received a copy of the CC0 Public Domain Dedication along with
+ * this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+
+#include <stdint.h>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "argon2.h"
+#include "argon2-core.h"
+
+
+struct Argon2_MemoryPool {
+    std::mutex mutex; //guards @free_regions
+    std::vector<Argon2_MemoryRegion*> free_regions; //regions not used by any call
+};
+
+Argon2_MemoryPool* CreateMemoryPool() {
+    return new (std::nothrow) Argon2_MemoryPool;
+}
+
+void DestroyMemoryPool(Argon2_MemoryPool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+    for (Argon2_MemoryRegion* region : pool->free_regions) {
+        UnmapMemory(region->memory, region->blocks); //also unlocks
+        delete region;
+    }
+    delete pool;
+}
+
+Argon2_MemoryRegion* AcquireRegion(Argon2_MemoryPool* pool, uint32_t blocks) {
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        // Best fit: the smallest free region that is large enough
+        size_t best = pool->free_regions.size();
+        for (size_t i = 0; i < pool->free_regions.size(); ++i) {
+            if (pool->free_regions[i]->blocks >= blocks &&
+                    (best == pool->free_regions.size() || pool->free_regions[i]->blocks < pool->free_regions[best]->blocks)) {
+                best = i;
+            }
+        }
+        if (best != pool->free_regions.size()) {
+            Argon2_MemoryRegion* region = pool->free_regions[best];
+            pool->free_regions.erase(pool->free_regions.begin() + best);
+            MetricsPool(true);
+            return region;
+        }
+    }
+
+    MetricsPool(false);
+    block* memory = NULL;
+    if (ARGON2_OK != MapMemory(&memory, blocks)) {
+        return NULL;
+    }
+    Argon2_MemoryRegion* region = new (std::nothrow) Argon2_MemoryRegion(memory, blocks);
+    if (region == NULL) {
+        UnmapMemory(memory, blocks);
+    }
+    return region;
+}
+
+void ReleaseRegion(Argon2_MemoryPool* pool, Argon2_MemoryRegion* region) {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->free_regions.push_back(region);
+}
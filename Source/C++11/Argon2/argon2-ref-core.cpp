@@ -24,6 +24,7 @@
 
 
 const char* ARGON2_KAT_FILENAME = "kat-argon2-ref.log";
+const char* ARGON2_IMPLEMENTATION = "ref";
 
 
 void FillBlock(const block* prev_block, const block* ref_block, block* next_block, const uint64_t* Sbox) {
@@ -93,14 +94,10 @@ void FillSegment(const Argon2_instance_t* instance, Argon2_position_t position)
     uint64_t pseudo_rand, ref_index, ref_lane;
     uint32_t prev_offset, curr_offset;
     bool data_independent_addressing = (instance->type == Argon2_i) || (instance->type == Argon2_id && (position.pass == 0) && (position.slice < ARGON2_SYNC_POINTS / 2));
-    // Pseudo-random values that determine the reference block position
-    uint64_t *pseudo_rands = new uint64_t[instance->segment_length];
-    if (pseudo_rands == NULL){
-        return;
-    }
-         
+    // Pseudo-random values that determine the reference block position, from the address table or the lane's scratch
+    const uint64_t *pseudo_rands = NULL;
     if (data_independent_addressing) {
-        GenerateAddresses(instance, &position, pseudo_rands);
+        pseudo_rands = SegmentAddresses(instance, &position);
     }
 
     uint32_t starting_index = 0;
@@ -108,9 +105,14 @@ void FillSegment(const Argon2_instance_t* instance, Argon2_position_t position)
         starting_index = 2; // we have already generated the first two blocks
     }
 
-    // Offset of the current block
-    curr_offset = position.lane * instance->lane_length + position.slice * instance->segment_length + starting_index;
-    if (0 == curr_offset % instance->lane_length) {
+    if (data_independent_addressing && instance->file_backed) {
+        PrefetchReferenceBlocks(instance, position, pseudo_rands, starting_index, 2 * ARGON2_PREFETCH_WINDOW);
+    }
+
+    // Offset of the current block within the lane
+    block* lane = instance->lane_memory[position.lane];
+    curr_offset = position.slice * instance->segment_length + starting_index;
+    if (0 == curr_offset) {
         // Last block in this lane
         prev_offset = curr_offset + instance->lane_length - 1;
     } else {
@@ -120,17 +122,21 @@ void FillSegment(const Argon2_instance_t* instance, Argon2_position_t position)
 
     for (uint32_t i = starting_index; i < instance->segment_length; ++i, ++curr_offset, ++prev_offset) {
         /*1.1 Rotating prev_offset if needed */
-        if (curr_offset % instance->lane_length == 1) {
+        if (curr_offset == 1) {
             prev_offset = curr_offset - 1;
         }
 
         /* 1.2 Computing the index of the reference block */
         /* 1.2.1 Taking pseudo-random value from the previous block */
         if (data_independent_addressing) {
+            if (instance->file_backed && i != 0 && (i % ARGON2_PREFETCH_WINDOW) == 0) {
+                // Reading ahead the next window, the blocks of the current one are already requested
+                PrefetchReferenceBlocks(instance, position, pseudo_rands, i + ARGON2_PREFETCH_WINDOW, i + 2 * ARGON2_PREFETCH_WINDOW);
+            }
             pseudo_rand = pseudo_rands[i];
         } 
         else {
-            pseudo_rand = instance->memory[prev_offset][0];
+            pseudo_rand = lane[prev_offset][0];
         }
 
         /* 1.2.2 Computing the lane of the reference block */
@@ -145,12 +151,10 @@ void FillSegment(const Argon2_instance_t* instance, Argon2_position_t position)
         ref_index = IndexAlpha(instance, &position, pseudo_rand & 0xFFFFFFFF, ref_lane == position.lane);
 
         /* 2 Creating a new block */
-        block* ref_block = instance->memory + instance->lane_length * ref_lane + ref_index;
-        block* curr_block = instance->memory + curr_offset;
-        FillBlock(instance->memory + prev_offset, ref_block, curr_block, instance->Sbox);
+        block* ref_block = instance->lane_memory[ref_lane] + ref_index;
+        block* curr_block = lane + curr_offset;
+        FillBlock(lane + prev_offset, ref_block, curr_block, instance->Sbox);
     }
-
-    delete[] pseudo_rands;
 }
     
 
@@ -158,7 +162,7 @@ void GenerateSbox(Argon2_instance_t* instance) {
     if (instance == NULL){
         return;
     }
-    block zero_block(0), start_block(instance->memory[0]), out_block(0);
+    block zero_block(0), start_block(instance->lane_memory[0][0]), out_block(0);
     
     if (instance->Sbox == NULL){
         instance->Sbox = new uint64_t[ARGON2_SBOX_SIZE];
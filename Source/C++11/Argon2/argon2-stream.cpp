@@ -0,0 +1,67 @@
+/*
+ * Argon2 source code package
+ * 
+ * Written by Daniel Dinu and Dmitry Khovratovich, 2015
+ * 
+ * This work is licensed under a Creative Commons CC0 1.0 License/Waiver.
+ * 
+ * You should have received a copy of the CC0 Public Domain Dedication along with
+ * this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+
+#include <stdint.h>
+#include <cstring>
+#include <new>
+
+#include "argon2.h"
+#include "argon2-core.h"
+
+#include "blake2.h"
+
+
+Argon2_OutputStream* CreateOutputStream() {
+    Argon2_OutputStream* stream = new (std::nothrow) Argon2_OutputStream;
+    if (stream != NULL) {
+        memset(&stream->state, 0, sizeof (stream->state));
+    }
+    return stream;
+}
+
+int OpenOutputStream(Argon2_OutputStream* stream, uint32_t outlen, const uint8_t* in, uint32_t inlen) {
+    if (stream == NULL) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+    if (blake2b_long_init(&stream->state, outlen, in, inlen) < 0) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+    return ARGON2_OK;
+}
+
+int ReadOutputStream(Argon2_OutputStream* stream, void* out, uint32_t length) {
+    if (stream == NULL) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+    if (out == NULL && length > 0) {
+        return ARGON2_OUTPUT_PTR_NULL;
+    }
+    if (length > blake2b_long_remaining(&stream->state)) {
+        return ARGON2_OUTPUT_TOO_LONG;
+    }
+    if (blake2b_long_read(&stream->state, out, length) < 0) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+    return ARGON2_OK;
+}
+
+uint32_t OutputStreamRemaining(const Argon2_OutputStream* stream) {
+    return (stream == NULL) ? 0 : (uint32_t) blake2b_long_remaining(&stream->state);
+}
+
+void DestroyOutputStream(Argon2_OutputStream* stream) {
+    if (stream == NULL) {
+        return;
+    }
+    secure_wipe_memory(&stream->state, sizeof (stream->state));
+    delete stream;
+}
@@ -0,0 +1,108 @@
+/*
+ * Argon2 source code package
+ *
+ * Written by Daniel Dinu and Dmitry Khovratovich, 2015
+ *
+ * This work is licensed under a Creative Commons CC0 1.0 License/Waiver.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along with
+ * this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <new>
+
+#include "argon2.h"
+#include "argon2-core.h"
+
+
+struct Argon2_ChromeTrace {
+    std::mutex mutex; //guards all members below
+    FILE* file; //JSON being written
+    bool first; //whether no event is written yet, for the separators
+    uint64_t start_ns; //steady clock at creation, the origin of the timeline
+    std::map<uint64_t, uint32_t> tids; //small thread numbers of the Argon2_TraceRecord thread ids, in order of appearance
+};
+
+static const char* const PHASE_NAMES[] = {
+    "", "allocate", "initial hash", "first blocks", "pass", "finalize", "free"
+};
+
+static uint64_t TraceNow() {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Argon2_ChromeTrace* CreateChromeTrace(const char* path) {
+    if (path == NULL) {
+        return NULL;
+    }
+    Argon2_ChromeTrace* trace = new (std::nothrow) Argon2_ChromeTrace;
+    if (trace == NULL) {
+        return NULL;
+    }
+    trace->file = fopen(path, "w");
+    if (trace->file == NULL) {
+        delete trace;
+        return NULL;
+    }
+    trace->first = true;
+    trace->start_ns = TraceNow();
+    fprintf(trace->file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    return trace;
+}
+
+void ChromeTraceCallback(void* user, const Argon2_TraceRecord* record) {
+    Argon2_ChromeTrace* trace = (Argon2_ChromeTrace*) user;
+    if (trace == NULL || record == NULL) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(trace->mutex);
+    auto tid = trace->tids.insert(std::make_pair(record->thread_id, (uint32_t) trace->tids.size() + 1)).first->second;
+    // Records of threads that started before the sink are clamped to its origin
+    const uint64_t ns = (record->timestamp_ns > trace->start_ns) ? record->timestamp_ns - trace->start_ns : 0;
+
+    fprintf(trace->file, "%s\n{\"pid\": 1, \"tid\": %u, \"ts\": %llu.%03u, \"cat\": \"argon2\", ", trace->first ? "" : ",",
+            tid, (unsigned long long) (ns / 1000), (unsigned) (ns % 1000));
+    trace->first = false;
+    switch (record->event) {
+    case ARGON2_TRACE_HASH_BEGIN:
+    case ARGON2_TRACE_HASH_END:
+        // Async events: calls overlap on the same thread in a batch and across threads otherwise
+        fprintf(trace->file, "\"ph\": \"%s\", \"name\": \"hash\", \"id\": \"%p\"}",
+                (ARGON2_TRACE_HASH_BEGIN == record->event) ? "b" : "e", (const void*) record->context);
+        break;
+    case ARGON2_TRACE_PHASE_BEGIN:
+    case ARGON2_TRACE_PHASE_END:
+        if (ARGON2_PHASE_PASS == record->phase) {
+            fprintf(trace->file, "\"ph\": \"%s\", \"name\": \"pass %u\"}",
+                    (ARGON2_TRACE_PHASE_BEGIN == record->event) ? "B" : "E", record->pass);
+        } else {
+            fprintf(trace->file, "\"ph\": \"%s\", \"name\": \"%s\"}",
+                    (ARGON2_TRACE_PHASE_BEGIN == record->event) ? "B" : "E", PHASE_NAMES[record->phase]);
+        }
+        break;
+    case ARGON2_TRACE_SEGMENT_BEGIN:
+    case ARGON2_TRACE_SEGMENT_END:
+        fprintf(trace->file, "\"ph\": \"%s\", \"name\": \"segment\", \"args\": {\"pass\": %u, \"lane\": %u, \"slice\": %u, "
+                "\"hash\": \"%p\"}}", (ARGON2_TRACE_SEGMENT_BEGIN == record->event) ? "B" : "E", record->pass,
+                record->lane, record->slice, (const void*) record->context);
+        break;
+    }
+}
+
+int DestroyChromeTrace(Argon2_ChromeTrace* trace) {
+    if (trace == NULL) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+    fprintf(trace->file, "\n]}\n");
+    bool failed = (0 != ferror(trace->file));
+    failed = (0 != fclose(trace->file)) || failed;
+    delete trace;
+    return failed ? ARGON2_TRACE_FILE_ERROR : ARGON2_OK;
+}
@@ -20,6 +20,9 @@
 
 extern const char* ARGON2_KAT_FILENAME;
 
+/* Name of the compiled core: "ref" for the reference code, "opt" for the SIMD code built with OPT=TRUE */
+extern const char* ARGON2_IMPLEMENTATION;
+
 const uint32_t ARGON2_T_COST_DEF= 3;
 const uint32_t ARGON2_LOG_M_COST_DEF= 12; /* 2^12 = 4 MiB */
 const uint32_t ARGON2_LANES_DEF =1;
@@ -80,6 +83,12 @@ const uint32_t ARGON2_MAX_SALT_LENGTH = 0xFFFFFFFF;
 const uint32_t ARGON2_MIN_SECRET = 0;
 const uint32_t ARGON2_MAX_SECRET = 0xFFFFFFFF;
 
+/* Largest fields of an encoded hash accepted by VerifyEncoded(), which decodes them on the stack */
+const uint32_t ARGON2_ENCODED_MAX_KEYID_LENGTH = 8;
+const uint32_t ARGON2_ENCODED_MAX_DATA_LENGTH = 32;
+const uint32_t ARGON2_ENCODED_MAX_SALT_LENGTH = 64;
+const uint32_t ARGON2_ENCODED_MAX_HASH_LENGTH = 128;
+
 /************************* Error codes *********************************************************************************/
 enum Argon2_ErrorCodes {
     ARGON2_OK = 0,
@@ -129,15 +138,341 @@ enum Argon2_ErrorCodes {
     ARGON2_THREADS_TOO_MANY = 29,
     ARGON2_MISSING_ARGS = 30,
 
+    ARGON2_BACKING_FILE_ERROR = 31,
+    ARGON2_MEMORY_LOCK_ERROR = 32,
+    ARGON2_VERIFY_MISMATCH = 33,
+
+    ARGON2_DECODING_FAIL = 34,
+    ARGON2_ENCODING_FAIL = 35,
+
+    ARGON2_TRACE_FILE_ERROR = 36,
+
+    ARGON2_SECRET_REQUIRED = 37,
+
     ARGON2_ERROR_CODES_LENGTH /* Do NOT remove; Do NOT add error codes after this error code */
 };
 
 
 
+/*
+ * One piece of an input that is given as a list of pieces (scatter-gather), see Argon2_Context
+ */
+struct Argon2_InputPart {
+    const uint8_t *data; //part array
+    uint32_t length; //part length
+};
+
+
+/* Argon2 primitive type */
+enum Argon2_type {
+    Argon2_d=0,
+    Argon2_i=1,
+    Argon2_id=2,
+    Argon2_ds=4
+};
+
+
 /********************************************* Memory allocator types --- for external allocation *************************************************************/
 typedef int (*AllocateMemoryCallback)(uint8_t **memory, size_t bytes_to_allocate);
 typedef void(*FreeMemoryCallback)(uint8_t *memory, size_t bytes_to_allocate);
 
+/********************************************* Memory pool --- for reusing the memory across calls *************************************************************/
+
+/*
+ * Pool of memory regions that outlive a single call. A context with @memory_pool set takes the smallest free region
+ * that is large enough (or maps a new one) and gives it back at the end, so repeated hashing does not pay for
+ * allocation, page faults and mlock() every time. Thread-safe.
+ */
+struct Argon2_MemoryPool;
+
+/*
+ * Creates an empty memory pool
+ * @return Pointer to the pool, NULL if it can not be allocated
+ */
+Argon2_MemoryPool* CreateMemoryPool();
+
+/*
+ * Frees all regions of the pool and the pool itself. No call may be using the pool at that time
+ * @param pool Pointer to the pool
+ */
+void DestroyMemoryPool(Argon2_MemoryPool* pool);
+
+/********************************************* Output stream --- for producing long tags in pieces *************************************************************/
+
+/*
+ * Reader of a tag that is produced incrementally, e.g. a long keystream for key derivation. A context with
+ * @output_stream set does not write @out (which may then be NULL): after the call, the @outlen bytes of the tag are
+ * read in pieces of any size with ReadOutputStream(). The memory of the hash is released before the call returns;
+ * the stream keeps 64 bytes of state and computes the output as it is read.
+ */
+struct Argon2_OutputStream;
+
+/*
+ * Creates an output stream with nothing to read
+ * @return Pointer to the stream, NULL if it can not be allocated
+ */
+Argon2_OutputStream* CreateOutputStream();
+
+/*
+ * Reads the next @a length bytes of the tag
+ * @param stream Pointer to the stream
+ * @param out Pointer to the memory where the bytes will be written
+ * @param length Number of bytes to read
+ * @return ARGON2_OK, or ARGON2_OUTPUT_TOO_LONG if fewer than @a length bytes remain (nothing is read then)
+ */
+int ReadOutputStream(Argon2_OutputStream* stream, void* out, uint32_t length);
+
+/*
+ * Number of bytes of the tag that are not read yet
+ * @param stream Pointer to the stream
+ */
+uint32_t OutputStreamRemaining(const Argon2_OutputStream* stream);
+
+/*
+ * Wipes and frees the stream
+ * @param stream Pointer to the stream
+ */
+void DestroyOutputStream(Argon2_OutputStream* stream);
+
+/********************************************* Encoded hash --- for storing the parameters together with the tag *************************************************************/
+
+/*
+ * Fields of a hash in the PHC string format, $argon2<T>$m=<num>,t=<num>,p=<num>[,keyid=<bin>][,data=<bin>]$<salt>$<hash>.
+ * For EncodeHash() the binary fields are inputs. For DecodeHash() they are caller buffers: the *len members give
+ * their capacity on entry and receive the decoded length; a NULL buffer only measures the field
+ */
+struct Argon2_EncodedHash {
+    Argon2_type type; //Argon2 type
+    uint32_t m_cost; //amount of memory requested (KB)
+    uint32_t t_cost; //number of passes
+    uint32_t lanes; //number of lanes
+
+    uint8_t *keyid; //key identifier
+    uint32_t keyidlen; //key identifier length
+    uint8_t *data; //associated data
+    uint32_t datalen; //associated data length
+    uint8_t *salt; //salt
+    uint32_t saltlen; //salt length
+    uint8_t *hash; //tag
+    uint32_t hashlen; //tag length
+};
+
+struct Argon2_Context;
+
+/*
+ * Writes the PHC string of @a encoded, zero-terminated
+ * @param dst Output buffer
+ * @param dst_len Size of @a dst in bytes, including the terminating zero
+ * @param encoded Fields to encode
+ * @return ARGON2_OK, ARGON2_ENCODING_FAIL if @a dst is too small
+ */
+int EncodeHash(char *dst, size_t dst_len, const Argon2_EncodedHash *encoded);
+
+/*
+ * Writes the PHC string of a hashed context: its parameters, associated data (as "data"), salt and @out. Salt and
+ * associated data given as parts are concatenated
+ * @param dst Output buffer
+ * @param dst_len Size of @a dst in bytes, including the terminating zero
+ * @param type Argon2 type the context was hashed with
+ * @param context Pointer to the hashed Argon2 context
+ * @return ARGON2_OK, ARGON2_ENCODING_FAIL if @a dst is too small, if the tag went to @output_stream instead of @out, or
+ * if the associated data, salt or tag exceed the ARGON2_ENCODED_MAX_* lengths that VerifyEncoded() accepts
+ */
+int EncodeString(char *dst, size_t dst_len, Argon2_type type, const Argon2_Context *context);
+
+/*
+ * Parses a PHC string into the caller buffers of @a decoded, without allocating
+ * @param decoded Parsed fields, with the capacities of the binary fields set on entry
+ * @param str Zero-terminated PHC string
+ * @return ARGON2_OK, ARGON2_DECODING_FAIL if the string is malformed or a field does not fit its buffer
+ */
+int DecodeHash(Argon2_EncodedHash *decoded, const char *str);
+
+/*
+ * Hashing parameters required of stored hashes, see NeedsRehash()
+ */
+struct Argon2_RehashPolicy {
+    Argon2_type type; //required Argon2 type
+    uint32_t m_cost; //minimum amount of memory (KB)
+    uint32_t t_cost; //minimum number of passes
+    uint32_t lanes; //required number of lanes
+    uint32_t outlen; //minimum tag length
+    uint32_t saltlen; //minimum salt length
+};
+
+/*
+ * Checks a PHC string against a policy by parsing it only, no hash is computed. A rehash is needed if the version
+ * ("$v=", if present) is not the one of this library, if the type or the number of lanes differs from the policy, or
+ * if the memory, passes, tag or salt are below it
+ * @param encoded Zero-terminated PHC string
+ * @param policy Required parameters
+ * @param needs_rehash Receives true if the hash does not meet @a policy
+ * @return ARGON2_OK, ARGON2_DECODING_FAIL if the string is malformed
+ */
+int NeedsRehash(const char *encoded, const Argon2_RehashPolicy *policy, bool *needs_rehash);
+
+/********************************************* Statistics --- for attributing the time of a call *************************************************************/
+
+/* Number of passes timed separately in Argon2_Stats, the time of later passes is added to the last entry */
+const uint32_t ARGON2_STATS_MAX_PASSES = 16;
+
+/*
+ * Where the time of one call went, in nanoseconds of the steady clock. Filled by a call whose context has @stats set;
+ * the phases follow each other, so they add up to @total_ns up to the cost of reading the clock. Batch calls fill
+ * the per-context phases only: the initial hash, first blocks and tag are shared by the batch and stay 0, and
+ * @total_ns is the time of the whole batch up to the release of this context's memory.
+ * Load balance of the lanes: every slice ends at a sync point where the threads wait for the slowest segment. The
+ * idle thread time of a slice, min(@threads, @lanes) times its wall time minus the compute time of its segments,
+ * is added to @barrier_wait_ns of that slice index; @barrier_wait_ns / (@threads * @slices_ns) is the share of the
+ * filling lost to imbalance. The compute time of every lane goes to the caller buffer @lane_ns, which keeps its
+ * pointer and capacity across calls
+ */
+struct Argon2_Stats {
+    uint64_t validate_ns; //ValidateInputs()
+    uint64_t allocate_ns; //memory, S-box and scratch allocation, and mlock() if requested
+    uint64_t initial_hash_ns; //InitialHash() of all inputs
+    uint64_t first_blocks_ns; //FillFirstBlocks(), and the wait for the threads faulting in the memory
+    uint64_t pass_ns[ARGON2_STATS_MAX_PASSES]; //FillMemoryBlocks(), per pass, with the S-box generation of the pass
+    uint64_t sbox_ns; //S-box generation of all passes, Argon2ds only
+    uint64_t finalize_ns; //XOR of the last blocks and the tag
+    uint64_t wipe_ns; //clearing the memory, if requested
+    uint64_t free_ns; //deallocation, or giving the memory back to the pool
+    uint64_t total_ns; //whole call
+    uint32_t passes; //number of passes run
+    uint32_t threads; //number of threads that filled the memory
+    uint64_t memory_bytes; //bytes of memory, S-box and address scratch touched by the call
+
+    uint64_t slices_ns; //wall time of all slices of all passes, the S-box generation excluded
+    uint64_t barrier_wait_ns[ARGON2_SYNC_POINTS]; //idle thread time at the end of every slice index, over all passes
+    uint64_t *lane_ns; //caller buffer receiving the compute time of every lane over all segments, NULL to skip
+    uint32_t lane_capacity; //number of entries of @lane_ns, lanes beyond it are not recorded
+
+    Argon2_Stats() : validate_ns(0), allocate_ns(0), initial_hash_ns(0), first_blocks_ns(0), pass_ns(), sbox_ns(0),
+    finalize_ns(0), wipe_ns(0), free_ns(0), total_ns(0), passes(0), threads(0), memory_bytes(0), slices_ns(0),
+    barrier_wait_ns(), lane_ns(NULL), lane_capacity(0) {
+    }
+};
+
+/********************************************* Tracing --- for viewing the calls on a timeline *************************************************************/
+
+/* What a trace record marks */
+enum Argon2_TraceEvent {
+    ARGON2_TRACE_HASH_BEGIN, //the call starts, after its inputs are validated
+    ARGON2_TRACE_HASH_END, //the call returns
+    ARGON2_TRACE_PHASE_BEGIN,
+    ARGON2_TRACE_PHASE_END,
+    ARGON2_TRACE_SEGMENT_BEGIN, //a thread starts filling a segment
+    ARGON2_TRACE_SEGMENT_END
+};
+
+/* Phases of a call, in the order they run. Batch calls only report their passes and the release of their memory */
+enum Argon2_TracePhase {
+    ARGON2_PHASE_NONE, //hash and segment records
+    ARGON2_PHASE_ALLOCATE, //memory, S-box and scratch allocation
+    ARGON2_PHASE_INITIAL_HASH, //InitialHash() of all inputs
+    ARGON2_PHASE_FIRST_BLOCKS, //the first blocks of every lane
+    ARGON2_PHASE_PASS, //one pass over the memory, @pass of the record tells which
+    ARGON2_PHASE_FINALIZE, //XOR of the last blocks and the tag
+    ARGON2_PHASE_FREE //wiping and releasing the memory
+};
+
+/*
+ * One event of a traced call. Segment records come from the threads that fill the segments, all others from the
+ * calling thread
+ */
+struct Argon2_TraceRecord {
+    Argon2_TraceEvent event;
+    Argon2_TracePhase phase;
+    const Argon2_Context *context; //call the event belongs to, tells concurrent calls apart
+    uint32_t pass; //pass of segment and pass records, 0 otherwise
+    uint32_t lane; //lane of segment records, 0 otherwise
+    uint32_t slice; //slice of segment records, 0 otherwise
+    uint64_t thread_id; //hash of the std::thread::id of the emitting thread
+    uint64_t timestamp_ns; //steady clock in nanoseconds
+};
+
+/*
+ * Receives the records of a call whose context has @trace_cbk set. It is called concurrently from the segment
+ * threads and must return quickly: the segments of a slice wait for each other
+ */
+typedef void (*TraceCallback)(void *user, const Argon2_TraceRecord *record);
+
+/*
+ * Built-in trace sink that writes the records as Chrome trace-event JSON, to be opened in chrome://tracing or
+ * Perfetto. Phases and segments are duration events on the thread that ran them, every call is an async event of
+ * its own so that overlapping calls show up as separate tracks. Pass the sink as @trace_user of any number of
+ * contexts, with ChromeTraceCallback as @trace_cbk. Thread-safe.
+ */
+struct Argon2_ChromeTrace;
+
+/*
+ * Creates a sink writing to a new file
+ * @param path Path of the file, created or truncated
+ * @return Pointer to the sink, NULL if the file can not be opened
+ */
+Argon2_ChromeTrace* CreateChromeTrace(const char* path);
+
+/*
+ * TraceCallback of the sink
+ * @param trace Pointer to an Argon2_ChromeTrace
+ * @param record Record to write
+ */
+void ChromeTraceCallback(void* trace, const Argon2_TraceRecord* record);
+
+/*
+ * Completes and closes the file and frees the sink. No traced call may be running at that time
+ * @param trace Pointer to the sink
+ * @return ARGON2_OK, or ARGON2_TRACE_FILE_ERROR if the file could not be written
+ */
+int DestroyChromeTrace(Argon2_ChromeTrace* trace);
+
+/********************************************* Metrics --- process-wide counters for monitoring *************************************************************/
+
+/* Size of the per-type arrays of Argon2_Metrics, indexed by the Argon2_type value */
+const uint32_t ARGON2_METRICS_TYPES = Argon2_ds + 1;
+
+/* Entry of the per-type arrays that counts the calls with a value that is not an Argon2_type, 3 not being one */
+const uint32_t ARGON2_METRICS_UNKNOWN_TYPE = 3;
+
+/* Buffer size that is always large enough for FormatMetrics() */
+const size_t ARGON2_METRICS_TEXT_LENGTH = 4096;
+
+/*
+ * Snapshot of the counters that every call of the process updates, whether or not it sets @stats. The calls count
+ * into per-thread shards with relaxed atomic additions, so a snapshot taken during calls is consistent per counter
+ * but not across counters. Counters only grow; the live memory and the queued jobs are gauges
+ */
+struct Argon2_Metrics {
+    uint64_t hashes_started[ARGON2_METRICS_TYPES]; //calls, every context of a batch counts as one
+    uint64_t hashes_completed[ARGON2_METRICS_TYPES]; //calls that returned ARGON2_OK
+    uint64_t hashes_failed[ARGON2_METRICS_TYPES]; //calls that returned an error, validation included
+    uint64_t memory_live_bytes; //block memory held by running calls
+    uint64_t memory_peak_bytes; //highest @memory_live_bytes so far
+    uint64_t pool_hits; //memory pool regions reused
+    uint64_t pool_misses; //memory pool regions mapped because no free one was large enough
+    uint64_t queued_jobs; //entries of VerifyEncodedBatch() calls that no worker has taken yet
+    uint64_t shared_address_tables; //entries of VerifyEncodedBatch() calls verified with the address table of their group
+    uint64_t threads_started; //segment and verify worker threads created
+    uint64_t setup_ns; //validation, allocation, initial hash and first blocks, over all calls
+    uint64_t fill_ns; //FillMemoryBlocks(), over all calls
+    uint64_t finalize_ns; //tag, wiping and releasing the memory, over all calls
+};
+
+/*
+ * Sums the shards of the process-wide counters
+ * @param metrics Receives the snapshot
+ */
+void GetMetrics(Argon2_Metrics *metrics);
+
+/*
+ * Writes @a metrics in the Prometheus text exposition format, zero-terminated
+ * @param dst Output buffer, ARGON2_METRICS_TEXT_LENGTH bytes are always enough
+ * @param dst_len Size of @a dst in bytes, including the terminating zero
+ * @param metrics Snapshot to format
+ * @return ARGON2_OK, ARGON2_ENCODING_FAIL if @a dst is too small
+ */
+int FormatMetrics(char *dst, size_t dst_len, const Argon2_Metrics *metrics);
+
 /********************************************* Argon2 external data structures*************************************************************/
 
 /*
@@ -159,6 +494,42 @@ typedef void(*FreeMemoryCallback)(uint8_t *memory, size_t bytes_to_allocate);
  You want to use the default memory allocator.
  Then you initialize
  Argon2_Context(out,8,pwd,32,salt,16,NULL,0,NULL,0,5,1<<20,4,NULL,NULL,true,false,false).
+ *
+ * Optional settings below do not affect the hash value. They get their defaults in the constructor and may be changed before the call.
+ *
+ * With @clear_memory the memory is overwritten with zeros by min(@threads, @lanes) threads, each wiping its own lanes.
+ * If the memory is mapped (@map_memory) and @discard_memory is set, the pages are instead released with madvise(MADV_DONTNEED)
+ * and unmapped, which writes nothing. The guarantee is weaker than the overwrite: the range reads back as zeros, and
+ * the kernel zeroes the released page frames before giving them to any process, but the old contents stay in physical
+ * RAM until the frames are reused (unless the kernel zeroes on free, e.g. Linux with init_on_free=1).
+ *
+ * If @backing_file is set, the memory is mapped from a new unnamed file in that directory instead of RAM, so that
+ * @m_cost may exceed the free memory. The file has no name while it is mapped (O_TMPFILE, or a mkstemp() file unlinked
+ * right away), so no existing file is touched. Use tmpfs or a fast SSD; the blocks written back to the storage are
+ * not erased by @clear_memory, so the device should be encrypted if that matters.
+ *
+ * If @lock_memory is set, the memory, the S-box and the address scratch are locked in RAM with mlock(), so they
+ * are neither swapped out nor paged in during the run. ARGON2_MEMORY_LOCK_ERROR is returned if that fails,
+ * typically because RLIMIT_MEMLOCK is too low. A region of @memory_pool is locked once, when it is first used by
+ * a locking call, and stays locked in the pool. Pooled memory is always overwritten by @clear_memory. Locked memory and
+ * scratch that would come from the heap are mapped instead, on pages of their own: mlock() does not nest, so
+ * unlocking a heap page would also unlock it for any other call that shares it.
+ * The memory comes from the first set of: @allocate_cbk, @memory_pool, @backing_file, @map_memory or @lock_memory,
+ * the heap.
+ *
+ * If @segmented_memory is set, every lane is allocated separately (a callback call, pool region, mapping or heap
+ * array per lane), so a large hash does not need one contiguous region. The backing file is always mapped as a whole.
+ *
+ * If @stats is set, the call writes the time of its phases there, see Argon2_Stats.
+ *
+ * If @trace_cbk is set, it is called with @trace_user at the start and end of the call, of its phases and of every
+ * segment, see Argon2_TraceRecord. Nothing is traced within a segment, so an unset callback costs one test per segment.
+ *
+ * Password, salt, secret and associated data may instead be given as lists of parts (@pwd_parts, @salt_parts,
+ * @secret_parts, @ad_parts) that are set after construction. Such an input is the concatenation of its parts and
+ * gives the same hash as the contiguous array; the parts are streamed into BLAKE2b without being copied. The
+ * contiguous pointer and length of that input must then be NULL and 0. Password and secret parts must be writable
+ * if they are to be cleared: @clear_password (@clear_secret) wipes every part and sets its length to 0.
  */
 struct Argon2_Context {
     uint8_t *out; //output array
@@ -190,6 +561,27 @@ struct Argon2_Context {
     
     const bool print; //whether to print the starting variables and the tag to the file - for test vectors only!
 
+    bool prefault_memory; //whether to fault in the internally allocated memory on extra threads while the first blocks are computed
+    bool map_memory; //whether to allocate the memory internally with an anonymous mmap() instead of the heap (POSIX only)
+    bool discard_memory; //whether @clear_memory releases the mapped pages instead of overwriting them, see above
+    const char *backing_file; //directory of the file to map the memory from, NULL to use RAM (POSIX only)
+    bool lock_memory; //whether to lock the memory in RAM (POSIX only)
+    Argon2_MemoryPool *memory_pool; //pool to take the memory from, NULL to allocate it for this call only
+    bool segmented_memory; //whether to allocate every lane separately instead of one contiguous region
+    Argon2_OutputStream *output_stream; //stream that receives the tag instead of @out, NULL to write @out
+    Argon2_Stats *stats; //receives the time of the phases of the call, NULL to not measure them
+    TraceCallback trace_cbk; //receives the trace records of the call, NULL to not trace it
+    void *trace_user; //first argument of @trace_cbk
+
+    Argon2_InputPart *pwd_parts; //password as a list of parts, NULL if @pwd is used
+    uint32_t pwd_parts_count; //number of password parts
+    const Argon2_InputPart *salt_parts; //salt as a list of parts, NULL if @salt is used
+    uint32_t salt_parts_count; //number of salt parts
+    Argon2_InputPart *secret_parts; //secret as a list of parts, NULL if @secret is used
+    uint32_t secret_parts_count; //number of secret parts
+    const Argon2_InputPart *ad_parts; //associated data as a list of parts, NULL if @ad is used
+    uint32_t ad_parts_count; //number of associated data parts
+
     Argon2_Context(uint8_t *o, uint32_t olen,
             /*const*/ uint8_t *m, uint32_t mlen,
             /*const*/ uint8_t *n, uint32_t nlen,
@@ -204,7 +596,13 @@ struct Argon2_Context {
     ad(a), adlen(alen),
     t_cost(t_c), m_cost(m_c), lanes(l), threads(thr),
     allocate_cbk(a_cbk), free_cbk(f_cbk), 
-    clear_password(c_p), clear_secret(c_s), clear_memory(c_m), print(p) {
+    clear_password(c_p), clear_secret(c_s), clear_memory(c_m), print(p),
+    prefault_memory(false), map_memory(false), discard_memory(false),
+    backing_file(NULL), lock_memory(false), memory_pool(NULL),
+    segmented_memory(false), output_stream(NULL), stats(NULL),
+    trace_cbk(NULL), trace_user(NULL),
+    pwd_parts(NULL), pwd_parts_count(0), salt_parts(NULL), salt_parts_count(0),
+    secret_parts(NULL), secret_parts_count(0), ad_parts(NULL), ad_parts_count(0) {
     }
 };
 
@@ -270,13 +668,68 @@ int Argon2ds(Argon2_Context* context);
 int Argon2id(Argon2_Context* context);
 
 /*
- * Verify if a given password is correct for Argon2d hashing
+ *   * **************Batch variants: hash @a count independent contexts with one call***************
+ * Meant for many small hashes, e.g. key stretching with 8-64 KiB of memory, where BLAKE2b pre- and post-hashing
+ * are a large part of the cost: these are computed several contexts at a time with a multi-buffer BLAKE2b.
+ * Every context produces the same tag as with the single-context function
+ * @param  contexts  Pointers to the Argon2 contexts
+ * @param  count  Number of contexts
+ * @param  results  If not NULL, receives the error code of every context
+ * @return  Zero if all contexts were hashed, the error code of the first failed context otherwise
+ */
+int Argon2dBatch(Argon2_Context** contexts, uint32_t count, int* results);
+int Argon2iBatch(Argon2_Context** contexts, uint32_t count, int* results);
+int Argon2idBatch(Argon2_Context** contexts, uint32_t count, int* results);
+int Argon2dsBatch(Argon2_Context** contexts, uint32_t count, int* results);
+
+/*
+ * Verify if a given password is correct for the given Argon2 type. The tag is computed into internal scratch and
+ * compared in constant time: @out of the context is neither read nor written (it may be NULL) and @output_stream
+ * is ignored. As with hashing, the password and secret are cleared if requested
+ * @param  type  Argon2 type
  * @param  context  Pointer to current Argon2 context
  * @param  hash  The password hash to verify. The length of the hash is specified by the context outlen member
- * @return  Zero if successful, a non zero error code otherwise
+ * @return  ARGON2_OK if the password matches, ARGON2_VERIFY_MISMATCH if it does not, another error code otherwise
+ */
+int Verify(Argon2_type type, Argon2_Context* context, const uint8_t *hash);
+
+/*
+ * Verify if a given password is correct for Argon2d hashing, same as Verify(Argon2_d, ...)
+ * @param  context  Pointer to current Argon2 context
+ * @param  hash  The password hash to verify. The length of the hash is specified by the context outlen member
+ * @return  ARGON2_OK if the password matches, ARGON2_VERIFY_MISMATCH if it does not, another error code otherwise
  */
 int VerifyD(Argon2_Context* context, const char *hash);
 
+/*
+ * Verify a password against a PHC string: the type, parameters, associated data, salt and tag are all taken from
+ * @a encoded. Fields longer than the ARGON2_ENCODED_MAX_* limits are rejected, so nothing is allocated but the
+ * memory of the hash itself. A string with a "keyid" was hashed with a secret, which is not known here, so it is
+ * rejected with ARGON2_SECRET_REQUIRED rather than reported as a mismatch
+ * @param  encoded  Zero-terminated PHC string, as written by EncodeString()
+ * @param  pwd  Password
+ * @param  pwdlen  Password length in bytes
+ * @return  ARGON2_OK if the password matches, ARGON2_VERIFY_MISMATCH if it does not, another error code otherwise
+ */
+int VerifyEncoded(const char *encoded, const uint8_t *pwd, uint32_t pwdlen);
+
+/*
+ * Verifies a batch of passwords against PHC strings, as VerifyEncoded() does for each pair. The entries are spread
+ * over @a threads workers, each hashing one entry at a time with a single thread. Entries with the same parameters
+ * are verified together: their memory comes from one pool and the reference block positions of Argon2i and Argon2id
+ * are computed once per group
+ * @param  encoded  Zero-terminated PHC strings
+ * @param  pwds  Passwords
+ * @param  pwdlens  Password lengths in bytes
+ * @param  count  Number of entries
+ * @param  threads  Number of workers
+ * @param  pool  Memory pool for the hashes, if NULL a pool is created for the call
+ * @param  results  If not NULL, receives the result of every entry: ARGON2_OK, ARGON2_VERIFY_MISMATCH or an error code
+ * @return  ARGON2_OK if every password matches, the result of the first other entry otherwise
+ */
+int VerifyEncodedBatch(const char *const *encoded, const uint8_t *const *pwds, const uint32_t *pwdlens, uint32_t count,
+        uint32_t threads, Argon2_MemoryPool *pool, int *results);
+
 /*
  * Get the associated error message for given erro code
  * @return  The error message associated with the given error code
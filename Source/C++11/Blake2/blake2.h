@@ -64,7 +64,43 @@ int blake2b(void *out, size_t outlen, const void *in, size_t inlen,
             const void *key, size_t keylen);
 
 /* Argon2 Team - Begin Code */
+/*
+ * Incremental blake2b_long: the output of blake2b_long(out, outlen, in, inlen)
+ * is produced in pieces of any size by blake2b_long_read, holding only the
+ * current 64-byte chaining value instead of the whole output.
+ */
+typedef struct __blake2b_long_state {
+    uint8_t v[BLAKE2B_OUTBYTES]; /* last BLAKE2b output */
+    unsigned offset;             /* bytes of v already read */
+    unsigned available;          /* bytes of v that belong to the output */
+    uint32_t toproduce;          /* output bytes not yet computed */
+} blake2b_long_state;
+
+int blake2b_long_init(blake2b_long_state *S, size_t outlen, const void *in,
+                      size_t inlen);
+int blake2b_long_read(blake2b_long_state *S, void *out, size_t outlen);
+/* Number of output bytes that can still be read */
+uint64_t blake2b_long_remaining(const blake2b_long_state *S);
+
+/* Name of the compression function compiled in: "AVX2", "SSE4.1" or "portable" */
+const char *blake2b_implementation(void);
 int blake2b_long(void *out, size_t outlen, const void *in, size_t inlen);
+
+/*
+ * Computes the unkeyed blake2b(out[i], outlen, in[i], inlen) for i < count,
+ * hashing blake2b_multi_lanes() messages at a time when a SIMD build allows it.
+ */
+int blake2b_multi(void *const *out, size_t outlen, const void *const *in,
+                  size_t inlen, size_t count);
+/*
+ * Computes blake2b_long(out[i], outlen, in[i], inlen) for i < count, hashing
+ * blake2b_multi_lanes() messages at a time when a SIMD build allows it.
+ * All inputs share one length and all outputs share one length.
+ */
+int blake2b_long_multi(void *const *out, size_t outlen, const void *const *in,
+                       size_t inlen, size_t count);
+/* Number of messages hashed together by blake2b_long_multi */
+size_t blake2b_multi_lanes(void);
 /* Argon2 Team - End Code */
 
 #if defined(__cplusplus)
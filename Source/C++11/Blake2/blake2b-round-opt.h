@@ -0,0 +1,176 @@
+#ifndef BLAKE2B_ROUND_OPT_H
+#define BLAKE2B_ROUND_OPT_H
+
+#include "blake2-impl.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include <immintrin.h>
+
+/*
+ * Vectorised BLAKE2b compression rounds. The state matrix is kept as four
+ * rows (a, b, c, d); the column step works on whole rows and the diagonal step
+ * rotates rows b, c and d so that the diagonals line up as columns.
+ *
+ * AVX2 keeps every row in a single 256-bit register. SSE4.1 splits each row
+ * into a low and a high 128-bit half and loads the message words with the
+ * shuffle schedule from blake2b-load-sse41.h.
+ */
+
+#if defined(__AVX2__)
+
+#define BLAKE2B_IMPLEMENTATION "AVX2"
+
+#define BLAKE2B_ROTR32_256(x) _mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define BLAKE2B_ROTR24_256(x)                                                  \
+    _mm256_shuffle_epi8((x), _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12,  \
+                                              13, 14, 15, 8, 9, 10, 3, 4, 5,   \
+                                              6, 7, 0, 1, 2, 11, 12, 13, 14,   \
+                                              15, 8, 9, 10))
+#define BLAKE2B_ROTR16_256(x)                                                  \
+    _mm256_shuffle_epi8((x), _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11,  \
+                                              12, 13, 14, 15, 8, 9, 2, 3, 4,   \
+                                              5, 6, 7, 0, 1, 10, 11, 12, 13,   \
+                                              14, 15, 8, 9))
+#define BLAKE2B_ROTR63_256(x)                                                  \
+    _mm256_xor_si256(_mm256_srli_epi64((x), 63), _mm256_add_epi64((x), (x)))
+
+/* Gathers message words s[i], s[i + 2], s[i + 4], s[i + 6] of one sigma row */
+#define BLAKE2B_LOAD_MSG_256(m, s, i)                                          \
+    _mm256_set_epi64x((int64_t)(m)[(s)[(i) + 6]], (int64_t)(m)[(s)[(i) + 4]],  \
+                      (int64_t)(m)[(s)[(i) + 2]], (int64_t)(m)[(s)[(i) + 0]])
+
+#define BLAKE2B_G1_256(a, b, c, d, msg)                                        \
+    do {                                                                       \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, msg), b);                     \
+        d = BLAKE2B_ROTR32_256(_mm256_xor_si256(d, a));                        \
+        c = _mm256_add_epi64(c, d);                                            \
+        b = BLAKE2B_ROTR24_256(_mm256_xor_si256(b, c));                        \
+    } while ((void)0, 0)
+
+#define BLAKE2B_G2_256(a, b, c, d, msg)                                        \
+    do {                                                                       \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, msg), b);                     \
+        d = BLAKE2B_ROTR16_256(_mm256_xor_si256(d, a));                        \
+        c = _mm256_add_epi64(c, d);                                            \
+        b = BLAKE2B_ROTR63_256(_mm256_xor_si256(b, c));                        \
+    } while ((void)0, 0)
+
+#define BLAKE2B_DIAGONALIZE_256(a, b, c, d)                                    \
+    do {                                                                       \
+        b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1));              \
+        c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));              \
+        d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(2, 1, 0, 3));              \
+    } while ((void)0, 0)
+
+#define BLAKE2B_UNDIAGONALIZE_256(a, b, c, d)                                  \
+    do {                                                                       \
+        b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3));              \
+        c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));              \
+        d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(0, 3, 2, 1));              \
+    } while ((void)0, 0)
+
+#define BLAKE2B_ROUND_256(a, b, c, d, m, s)                                    \
+    do {                                                                       \
+        BLAKE2B_G1_256(a, b, c, d, BLAKE2B_LOAD_MSG_256(m, s, 0));             \
+        BLAKE2B_G2_256(a, b, c, d, BLAKE2B_LOAD_MSG_256(m, s, 1));             \
+        BLAKE2B_DIAGONALIZE_256(a, b, c, d);                                   \
+        BLAKE2B_G1_256(a, b, c, d, BLAKE2B_LOAD_MSG_256(m, s, 8));             \
+        BLAKE2B_G2_256(a, b, c, d, BLAKE2B_LOAD_MSG_256(m, s, 9));             \
+        BLAKE2B_UNDIAGONALIZE_256(a, b, c, d);                                 \
+    } while ((void)0, 0)
+
+#elif defined(__SSE4_1__)
+
+#define BLAKE2B_IMPLEMENTATION "SSE4.1"
+
+#include "blake2b-load-sse41.h"
+
+#define BLAKE2B_ROTR32_128(x) _mm_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define BLAKE2B_ROTR24_128(x)                                                  \
+    _mm_shuffle_epi8((x), _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13,    \
+                                        14, 15, 8, 9, 10))
+#define BLAKE2B_ROTR16_128(x)                                                  \
+    _mm_shuffle_epi8((x), _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12,    \
+                                        13, 14, 15, 8, 9))
+#define BLAKE2B_ROTR63_128(x)                                                  \
+    _mm_xor_si128(_mm_srli_epi64((x), 63), _mm_add_epi64((x), (x)))
+
+#define BLAKE2B_G1_128(al, bl, cl, dl, ah, bh, ch, dh, b0, b1)                 \
+    do {                                                                       \
+        al = _mm_add_epi64(_mm_add_epi64(al, b0), bl);                         \
+        ah = _mm_add_epi64(_mm_add_epi64(ah, b1), bh);                         \
+        dl = BLAKE2B_ROTR32_128(_mm_xor_si128(dl, al));                        \
+        dh = BLAKE2B_ROTR32_128(_mm_xor_si128(dh, ah));                        \
+        cl = _mm_add_epi64(cl, dl);                                            \
+        ch = _mm_add_epi64(ch, dh);                                            \
+        bl = BLAKE2B_ROTR24_128(_mm_xor_si128(bl, cl));                        \
+        bh = BLAKE2B_ROTR24_128(_mm_xor_si128(bh, ch));                        \
+    } while ((void)0, 0)
+
+#define BLAKE2B_G2_128(al, bl, cl, dl, ah, bh, ch, dh, b0, b1)                 \
+    do {                                                                       \
+        al = _mm_add_epi64(_mm_add_epi64(al, b0), bl);                         \
+        ah = _mm_add_epi64(_mm_add_epi64(ah, b1), bh);                         \
+        dl = BLAKE2B_ROTR16_128(_mm_xor_si128(dl, al));                        \
+        dh = BLAKE2B_ROTR16_128(_mm_xor_si128(dh, ah));                        \
+        cl = _mm_add_epi64(cl, dl);                                            \
+        ch = _mm_add_epi64(ch, dh);                                            \
+        bl = BLAKE2B_ROTR63_128(_mm_xor_si128(bl, cl));                        \
+        bh = BLAKE2B_ROTR63_128(_mm_xor_si128(bh, ch));                        \
+    } while ((void)0, 0)
+
+#define BLAKE2B_DIAGONALIZE_128(al, bl, cl, dl, ah, bh, ch, dh)                \
+    do {                                                                       \
+        __m128i t0 = _mm_alignr_epi8(bh, bl, 8);                               \
+        __m128i t1 = _mm_alignr_epi8(bl, bh, 8);                               \
+        bl = t0;                                                               \
+        bh = t1;                                                               \
+                                                                               \
+        t0 = cl;                                                               \
+        cl = ch;                                                               \
+        ch = t0;                                                               \
+                                                                               \
+        t0 = _mm_alignr_epi8(dh, dl, 8);                                       \
+        t1 = _mm_alignr_epi8(dl, dh, 8);                                       \
+        dl = t1;                                                               \
+        dh = t0;                                                               \
+    } while ((void)0, 0)
+
+#define BLAKE2B_UNDIAGONALIZE_128(al, bl, cl, dl, ah, bh, ch, dh)              \
+    do {                                                                       \
+        __m128i t0 = _mm_alignr_epi8(bl, bh, 8);                               \
+        __m128i t1 = _mm_alignr_epi8(bh, bl, 8);                               \
+        bl = t0;                                                               \
+        bh = t1;                                                               \
+                                                                               \
+        t0 = cl;                                                               \
+        cl = ch;                                                               \
+        ch = t0;                                                               \
+                                                                               \
+        t0 = _mm_alignr_epi8(dl, dh, 8);                                       \
+        t1 = _mm_alignr_epi8(dh, dl, 8);                                       \
+        dl = t1;                                                               \
+        dh = t0;                                                               \
+    } while ((void)0, 0)
+
+/* Expects the message in m0..m7 and scratch registers b0, b1 in scope */
+#define BLAKE2B_ROUND_128(r, al, bl, cl, dl, ah, bh, ch, dh)                   \
+    do {                                                                       \
+        LOAD_MSG_##r##_1(b0, b1);                                              \
+        BLAKE2B_G1_128(al, bl, cl, dl, ah, bh, ch, dh, b0, b1);                \
+        LOAD_MSG_##r##_2(b0, b1);                                              \
+        BLAKE2B_G2_128(al, bl, cl, dl, ah, bh, ch, dh, b0, b1);                \
+        BLAKE2B_DIAGONALIZE_128(al, bl, cl, dl, ah, bh, ch, dh);               \
+        LOAD_MSG_##r##_3(b0, b1);                                              \
+        BLAKE2B_G1_128(al, bl, cl, dl, ah, bh, ch, dh, b0, b1);                \
+        LOAD_MSG_##r##_4(b0, b1);                                              \
+        BLAKE2B_G2_128(al, bl, cl, dl, ah, bh, ch, dh, b0, b1);                \
+        BLAKE2B_UNDIAGONALIZE_128(al, bl, cl, dl, ah, bh, ch, dh);             \
+    } while ((void)0, 0)
+
+#endif
+
+#endif
@@ -5,6 +5,12 @@
 #include "blake2.h"
 #include "blake2-impl.h"
 
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include "blake2b-round-opt.h"
+#else
+#define BLAKE2B_IMPLEMENTATION "portable"
+#endif
+
 static const uint64_t blake2b_IV[8] = {
     UINT64_C(0x6a09e667f3bcc908), UINT64_C(0xbb67ae8584caa73b),
     UINT64_C(0x3c6ef372fe94f82b), UINT64_C(0xa54ff53a5f1d36f1),
@@ -145,6 +151,90 @@ int blake2b_init_key(blake2b_state *S, size_t outlen, const void *key,
     return 0;
 }
 
+#if defined(__AVX2__)
+static void blake2b_compress(blake2b_state *S, const uint8_t *block) {
+    uint64_t m[16];
+    __m256i a, b, c, d;
+    const __m256i h0 = _mm256_loadu_si256((const __m256i *)&S->h[0]);
+    const __m256i h1 = _mm256_loadu_si256((const __m256i *)&S->h[4]);
+    unsigned int i;
+
+    for (i = 0; i < 16; ++i) {
+        m[i] = load64(block + i * sizeof(m[i]));
+    }
+
+    a = h0;
+    b = h1;
+    c = _mm256_loadu_si256((const __m256i *)&blake2b_IV[0]);
+    d = _mm256_xor_si256(
+        _mm256_loadu_si256((const __m256i *)&blake2b_IV[4]),
+        _mm256_set_epi64x((int64_t)S->f[1], (int64_t)S->f[0],
+                          (int64_t)S->t[1], (int64_t)S->t[0]));
+
+    BLAKE2B_ROUND_256(a, b, c, d, m, blake2b_sigma[0]);
+    BLAKE2B_ROUND_256(a, b, c, d, m, blake2b_sigma[1]);
+    BLAKE2B_ROUND_256(a, b, c, d, m, blake2b_sigma[2]);
+    BLAKE2B_ROUND_256(a, b, c, d, m, blake2b_sigma[3]);
+    BLAKE2B_ROUND_256(a, b, c, d, m, blake2b_sigma[4]);
+    BLAKE2B_ROUND_256(a, b, c, d, m, blake2b_sigma[5]);
+    BLAKE2B_ROUND_256(a, b, c, d, m, blake2b_sigma[6]);
+    BLAKE2B_ROUND_256(a, b, c, d, m, blake2b_sigma[7]);
+    BLAKE2B_ROUND_256(a, b, c, d, m, blake2b_sigma[8]);
+    BLAKE2B_ROUND_256(a, b, c, d, m, blake2b_sigma[9]);
+    BLAKE2B_ROUND_256(a, b, c, d, m, blake2b_sigma[10]);
+    BLAKE2B_ROUND_256(a, b, c, d, m, blake2b_sigma[11]);
+
+    _mm256_storeu_si256((__m256i *)&S->h[0],
+                        _mm256_xor_si256(h0, _mm256_xor_si256(a, c)));
+    _mm256_storeu_si256((__m256i *)&S->h[4],
+                        _mm256_xor_si256(h1, _mm256_xor_si256(b, d)));
+}
+#elif defined(__SSE4_1__)
+static void blake2b_compress(blake2b_state *S, const uint8_t *block) {
+    const __m128i m0 = _mm_loadu_si128((const __m128i *)(block + 0));
+    const __m128i m1 = _mm_loadu_si128((const __m128i *)(block + 16));
+    const __m128i m2 = _mm_loadu_si128((const __m128i *)(block + 32));
+    const __m128i m3 = _mm_loadu_si128((const __m128i *)(block + 48));
+    const __m128i m4 = _mm_loadu_si128((const __m128i *)(block + 64));
+    const __m128i m5 = _mm_loadu_si128((const __m128i *)(block + 80));
+    const __m128i m6 = _mm_loadu_si128((const __m128i *)(block + 96));
+    const __m128i m7 = _mm_loadu_si128((const __m128i *)(block + 112));
+    const __m128i h0 = _mm_loadu_si128((const __m128i *)&S->h[0]);
+    const __m128i h1 = _mm_loadu_si128((const __m128i *)&S->h[2]);
+    const __m128i h2 = _mm_loadu_si128((const __m128i *)&S->h[4]);
+    const __m128i h3 = _mm_loadu_si128((const __m128i *)&S->h[6]);
+    __m128i al = h0, ah = h1, bl = h2, bh = h3;
+    __m128i cl = _mm_loadu_si128((const __m128i *)&blake2b_IV[0]);
+    __m128i ch = _mm_loadu_si128((const __m128i *)&blake2b_IV[2]);
+    __m128i dl = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&blake2b_IV[4]),
+                               _mm_loadu_si128((const __m128i *)&S->t[0]));
+    __m128i dh = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&blake2b_IV[6]),
+                               _mm_loadu_si128((const __m128i *)&S->f[0]));
+    __m128i b0, b1;
+
+    BLAKE2B_ROUND_128(0, al, bl, cl, dl, ah, bh, ch, dh);
+    BLAKE2B_ROUND_128(1, al, bl, cl, dl, ah, bh, ch, dh);
+    BLAKE2B_ROUND_128(2, al, bl, cl, dl, ah, bh, ch, dh);
+    BLAKE2B_ROUND_128(3, al, bl, cl, dl, ah, bh, ch, dh);
+    BLAKE2B_ROUND_128(4, al, bl, cl, dl, ah, bh, ch, dh);
+    BLAKE2B_ROUND_128(5, al, bl, cl, dl, ah, bh, ch, dh);
+    BLAKE2B_ROUND_128(6, al, bl, cl, dl, ah, bh, ch, dh);
+    BLAKE2B_ROUND_128(7, al, bl, cl, dl, ah, bh, ch, dh);
+    BLAKE2B_ROUND_128(8, al, bl, cl, dl, ah, bh, ch, dh);
+    BLAKE2B_ROUND_128(9, al, bl, cl, dl, ah, bh, ch, dh);
+    BLAKE2B_ROUND_128(10, al, bl, cl, dl, ah, bh, ch, dh);
+    BLAKE2B_ROUND_128(11, al, bl, cl, dl, ah, bh, ch, dh);
+
+    _mm_storeu_si128((__m128i *)&S->h[0],
+                     _mm_xor_si128(h0, _mm_xor_si128(al, cl)));
+    _mm_storeu_si128((__m128i *)&S->h[2],
+                     _mm_xor_si128(h1, _mm_xor_si128(ah, ch)));
+    _mm_storeu_si128((__m128i *)&S->h[4],
+                     _mm_xor_si128(h2, _mm_xor_si128(bl, dl)));
+    _mm_storeu_si128((__m128i *)&S->h[6],
+                     _mm_xor_si128(h3, _mm_xor_si128(bh, dh)));
+}
+#else
 static void blake2b_compress(blake2b_state *S, const uint8_t *block) {
     uint64_t m[16];
     uint64_t v[16];
@@ -202,6 +292,9 @@ static void blake2b_compress(blake2b_state *S, const uint8_t *block) {
 #undef G
 #undef ROUND
 }
+#endif
+
+const char *blake2b_implementation(void) { return BLAKE2B_IMPLEMENTATION; }
 
 int blake2b_update(blake2b_state *S, const void *in, size_t inlen) {
     const uint8_t *pin = (const uint8_t *)in;
@@ -369,4 +462,394 @@ fail:
     return ret;
 #undef TRY
 }
+
+int blake2b_long_init(blake2b_long_state *S, size_t outlen, const void *in,
+                      size_t inlen) {
+    blake2b_state blake_state;
+    uint8_t outlen_bytes[sizeof(uint32_t)] = {0};
+    size_t first = (outlen <= BLAKE2B_OUTBYTES) ? outlen : BLAKE2B_OUTBYTES;
+    int ret = -1;
+
+    if (S == NULL || outlen == 0 || outlen > UINT32_MAX ||
+        (in == NULL && inlen > 0)) {
+        return -1;
+    }
+    memset(S, 0, sizeof(*S));
+
+    /* Same first step as blake2b_long */
+    store32(outlen_bytes, (uint32_t)outlen);
+    if (blake2b_init(&blake_state, first) < 0 ||
+        blake2b_update(&blake_state, outlen_bytes, sizeof(outlen_bytes)) < 0 ||
+        blake2b_update(&blake_state, in, inlen) < 0 ||
+        blake2b_final(&blake_state, S->v, first) < 0) {
+        goto fail;
+    }
+    if (outlen <= BLAKE2B_OUTBYTES) {
+        S->available = (unsigned)outlen;
+        S->toproduce = 0;
+    } else {
+        S->available = BLAKE2B_OUTBYTES / 2;
+        S->toproduce = (uint32_t)outlen - BLAKE2B_OUTBYTES / 2;
+    }
+    ret = 0;
+
+fail:
+    burn(&blake_state, sizeof(blake_state));
+    if (ret < 0) {
+        burn(S, sizeof(*S));
+    }
+    return ret;
+}
+
+int blake2b_long_read(blake2b_long_state *S, void *pout, size_t outlen) {
+    uint8_t *out = (uint8_t *)pout;
+    uint8_t in_buffer[BLAKE2B_OUTBYTES];
+
+    if (S == NULL || (out == NULL && outlen > 0) ||
+        outlen > blake2b_long_remaining(S)) {
+        return -1;
+    }
+
+    while (outlen > 0) {
+        size_t chunk;
+        if (S->offset == S->available) {
+            /* Next step of blake2b_long: half of every intermediate hash,
+             * all of the last one */
+            const size_t next = (S->toproduce > BLAKE2B_OUTBYTES)
+                                    ? BLAKE2B_OUTBYTES
+                                    : S->toproduce;
+            memcpy(in_buffer, S->v, BLAKE2B_OUTBYTES);
+            if (blake2b(S->v, next, in_buffer, BLAKE2B_OUTBYTES, NULL, 0) < 0) {
+                burn(in_buffer, sizeof(in_buffer));
+                return -1;
+            }
+            S->offset = 0;
+            if (S->toproduce > BLAKE2B_OUTBYTES) {
+                S->available = BLAKE2B_OUTBYTES / 2;
+                S->toproduce -= BLAKE2B_OUTBYTES / 2;
+            } else {
+                S->available = (unsigned)S->toproduce;
+                S->toproduce = 0;
+            }
+        }
+        chunk = S->available - S->offset;
+        if (chunk > outlen) {
+            chunk = outlen;
+        }
+        memcpy(out, S->v + S->offset, chunk);
+        S->offset += (unsigned)chunk;
+        out += chunk;
+        outlen -= chunk;
+    }
+    burn(in_buffer, sizeof(in_buffer));
+    if (blake2b_long_remaining(S) == 0) {
+        burn(S->v, sizeof(S->v));
+    }
+    return 0;
+}
+
+uint64_t blake2b_long_remaining(const blake2b_long_state *S) {
+    return (S == NULL) ? 0 : (uint64_t)(S->available - S->offset) + S->toproduce;
+}
+
+/*
+ * Multi-buffer BLAKE2b. BLAKE2B_MULTI_LANES independent messages of equal
+ * length are hashed together, with the state kept transposed so that vector
+ * register w holds word w of every message. All messages go through exactly
+ * the same sequence of compressions, so lanes never diverge. Each message is
+ * the concatenation prefix || in[lane], which lets blake2b_long_multi prepend
+ * the output length without copying its inputs.
+ */
+#if defined(__AVX512F__)
+#define BLAKE2B_MULTI_LANES 8
+
+typedef __m512i blake2b_vec;
+
+#define VADD(a, b) _mm512_add_epi64((a), (b))
+#define VXOR(a, b) _mm512_xor_si512((a), (b))
+#define VSET1(x) _mm512_set1_epi64((int64_t)(x))
+/* The zero-masked form avoids the undefined source operand of _mm512_ror_epi64 */
+#define VROR(x, c) _mm512_maskz_ror_epi64((__mmask8)0xFF, (x), (c))
+#define VROR32(x) VROR((x), 32)
+#define VROR24(x) VROR((x), 24)
+#define VROR16(x) VROR((x), 16)
+#define VROR63(x) VROR((x), 63)
+#define VSTORE(p, x) _mm512_storeu_si512((void *)(p), (x))
+
+static BLAKE2_INLINE blake2b_vec blake2b_gather_word(const uint8_t *const *p,
+                                                     size_t offset) {
+    return _mm512_set_epi64(
+        (int64_t)load64(p[7] + offset), (int64_t)load64(p[6] + offset),
+        (int64_t)load64(p[5] + offset), (int64_t)load64(p[4] + offset),
+        (int64_t)load64(p[3] + offset), (int64_t)load64(p[2] + offset),
+        (int64_t)load64(p[1] + offset), (int64_t)load64(p[0] + offset));
+}
+#elif defined(__AVX2__)
+#define BLAKE2B_MULTI_LANES 4
+
+typedef __m256i blake2b_vec;
+
+#define VADD(a, b) _mm256_add_epi64((a), (b))
+#define VXOR(a, b) _mm256_xor_si256((a), (b))
+#define VSET1(x) _mm256_set1_epi64x((int64_t)(x))
+#define VROR32(x) BLAKE2B_ROTR32_256(x)
+#define VROR24(x) BLAKE2B_ROTR24_256(x)
+#define VROR16(x) BLAKE2B_ROTR16_256(x)
+#define VROR63(x) BLAKE2B_ROTR63_256(x)
+#define VSTORE(p, x) _mm256_storeu_si256((__m256i *)(p), (x))
+
+static BLAKE2_INLINE blake2b_vec blake2b_gather_word(const uint8_t *const *p,
+                                                     size_t offset) {
+    return _mm256_set_epi64x(
+        (int64_t)load64(p[3] + offset), (int64_t)load64(p[2] + offset),
+        (int64_t)load64(p[1] + offset), (int64_t)load64(p[0] + offset));
+}
+#else
+#define BLAKE2B_MULTI_LANES 1
+#endif
+
+#if BLAKE2B_MULTI_LANES > 1
+static void blake2b_compress_multi(blake2b_vec *h,
+                                   const uint8_t *const *blocks, uint64_t t0,
+                                   uint64_t t1, uint64_t f0) {
+    blake2b_vec m[16];
+    blake2b_vec v[16];
+    unsigned int i, r;
+
+    for (i = 0; i < 16; ++i) {
+        m[i] = blake2b_gather_word(blocks, i * sizeof(uint64_t));
+    }
+    for (i = 0; i < 8; ++i) {
+        v[i] = h[i];
+    }
+    v[8] = VSET1(blake2b_IV[0]);
+    v[9] = VSET1(blake2b_IV[1]);
+    v[10] = VSET1(blake2b_IV[2]);
+    v[11] = VSET1(blake2b_IV[3]);
+    v[12] = VSET1(blake2b_IV[4] ^ t0);
+    v[13] = VSET1(blake2b_IV[5] ^ t1);
+    v[14] = VSET1(blake2b_IV[6] ^ f0);
+    v[15] = VSET1(blake2b_IV[7]);
+
+#define G(r, i, a, b, c, d)                                                    \
+    do {                                                                       \
+        a = VADD(VADD(a, b), m[blake2b_sigma[r][2 * i + 0]]);                  \
+        d = VROR32(VXOR(d, a));                                                \
+        c = VADD(c, d);                                                        \
+        b = VROR24(VXOR(b, c));                                                \
+        a = VADD(VADD(a, b), m[blake2b_sigma[r][2 * i + 1]]);                  \
+        d = VROR16(VXOR(d, a));                                                \
+        c = VADD(c, d);                                                        \
+        b = VROR63(VXOR(b, c));                                                \
+    } while ((void)0, 0)
+
+    for (r = 0; r < 12; ++r) {
+        G(r, 0, v[0], v[4], v[8], v[12]);
+        G(r, 1, v[1], v[5], v[9], v[13]);
+        G(r, 2, v[2], v[6], v[10], v[14]);
+        G(r, 3, v[3], v[7], v[11], v[15]);
+        G(r, 4, v[0], v[5], v[10], v[15]);
+        G(r, 5, v[1], v[6], v[11], v[12]);
+        G(r, 6, v[2], v[7], v[8], v[13]);
+        G(r, 7, v[3], v[4], v[9], v[14]);
+    }
+
+#undef G
+
+    for (i = 0; i < 8; ++i) {
+        h[i] = VXOR(h[i], VXOR(v[i], v[i + 8]));
+    }
+}
+
+/* Copies bytes [offset, offset + length) of prefix || in into dst */
+static void blake2b_copy_message(uint8_t *dst, const uint8_t *prefix,
+                                 size_t prefixlen, const uint8_t *in,
+                                 size_t offset, size_t length) {
+    if (offset < prefixlen) {
+        size_t head = prefixlen - offset;
+        if (head > length) {
+            head = length;
+        }
+        memcpy(dst, prefix + offset, head);
+        dst += head;
+        length -= head;
+        offset = prefixlen;
+    }
+    if (length > 0) {
+        memcpy(dst, in + (offset - prefixlen), length);
+    }
+}
+
+/* Unkeyed BLAKE2b of prefix || in[lane] for every lane, outlen <= 64 */
+static void blake2b_hash_lanes(uint8_t *const *out, size_t outlen,
+                               const uint8_t *prefix, size_t prefixlen,
+                               const uint8_t *const *in, size_t inlen) {
+    blake2b_vec h[8];
+    uint64_t words[8][BLAKE2B_MULTI_LANES];
+    uint8_t buffers[BLAKE2B_MULTI_LANES][BLAKE2B_BLOCKBYTES];
+    const uint8_t *blocks[BLAKE2B_MULTI_LANES];
+    const size_t total = prefixlen + inlen;
+    size_t offset = 0;
+    unsigned int i, lane;
+
+    for (i = 0; i < 8; ++i) {
+        h[i] = VSET1(blake2b_IV[i]);
+    }
+    /* Parameter block: digest length, no key, fanout 1, depth 1 */
+    h[0] = VXOR(h[0], VSET1(UINT64_C(0x01010000) ^ (uint64_t)outlen));
+
+    do {
+        const size_t length = (total - offset > BLAKE2B_BLOCKBYTES)
+                                  ? BLAKE2B_BLOCKBYTES
+                                  : total - offset;
+        const int last = (offset + length == total);
+
+        for (lane = 0; lane < BLAKE2B_MULTI_LANES; ++lane) {
+            /* Whole blocks past the prefix are read in place */
+            if (!last && offset >= prefixlen) {
+                blocks[lane] = in[lane] + (offset - prefixlen);
+                continue;
+            }
+            memset(buffers[lane], 0, BLAKE2B_BLOCKBYTES);
+            blake2b_copy_message(buffers[lane], prefix, prefixlen, in[lane],
+                                 offset, length);
+            blocks[lane] = buffers[lane];
+        }
+        offset += length;
+        blake2b_compress_multi(h, blocks, (uint64_t)offset, 0,
+                               last ? (uint64_t)-1 : 0);
+    } while (offset < total);
+
+    for (i = 0; i < 8; ++i) {
+        VSTORE(words[i], h[i]);
+    }
+    for (lane = 0; lane < BLAKE2B_MULTI_LANES; ++lane) {
+        uint8_t digest[BLAKE2B_OUTBYTES];
+        for (i = 0; i < 8; ++i) {
+            store64(digest + i * sizeof(uint64_t), words[i][lane]);
+        }
+        memcpy(out[lane], digest, outlen);
+        burn(digest, sizeof(digest));
+    }
+    burn(words, sizeof(words));
+    burn(buffers, sizeof(buffers));
+    burn(h, sizeof(h));
+}
+
+/* blake2b_long for exactly BLAKE2B_MULTI_LANES messages of equal length */
+static void blake2b_long_lanes(uint8_t *const *out, size_t outlen,
+                               const uint8_t *const *in, size_t inlen) {
+    uint8_t outlen_bytes[sizeof(uint32_t)] = {0};
+    uint8_t v[BLAKE2B_MULTI_LANES][BLAKE2B_OUTBYTES];
+    uint8_t w[BLAKE2B_MULTI_LANES][BLAKE2B_OUTBYTES];
+    uint8_t *v_out[BLAKE2B_MULTI_LANES];
+    uint8_t *w_out[BLAKE2B_MULTI_LANES];
+    uint8_t *dst[BLAKE2B_MULTI_LANES];
+    const uint8_t *v_in[BLAKE2B_MULTI_LANES];
+    unsigned int lane;
+
+    store32(outlen_bytes, (uint32_t)outlen);
+
+    if (outlen <= BLAKE2B_OUTBYTES) {
+        blake2b_hash_lanes(out, outlen, outlen_bytes, sizeof(outlen_bytes), in,
+                           inlen);
+        return;
+    }
+
+    for (lane = 0; lane < BLAKE2B_MULTI_LANES; ++lane) {
+        v_out[lane] = v[lane];
+        w_out[lane] = w[lane];
+        v_in[lane] = v[lane];
+        dst[lane] = out[lane];
+    }
+
+    uint32_t toproduce = (uint32_t)outlen - BLAKE2B_OUTBYTES / 2;
+    blake2b_hash_lanes(v_out, BLAKE2B_OUTBYTES, outlen_bytes,
+                       sizeof(outlen_bytes), in, inlen);
+    while (1) {
+        for (lane = 0; lane < BLAKE2B_MULTI_LANES; ++lane) {
+            memcpy(dst[lane], v[lane], BLAKE2B_OUTBYTES / 2);
+            dst[lane] += BLAKE2B_OUTBYTES / 2;
+        }
+        if (toproduce <= BLAKE2B_OUTBYTES) {
+            break;
+        }
+        blake2b_hash_lanes(w_out, BLAKE2B_OUTBYTES, NULL, 0, v_in,
+                           BLAKE2B_OUTBYTES);
+        memcpy(v, w, sizeof(v));
+        toproduce -= BLAKE2B_OUTBYTES / 2;
+    }
+    blake2b_hash_lanes(dst, toproduce, NULL, 0, v_in, BLAKE2B_OUTBYTES);
+
+    burn(v, sizeof(v));
+    burn(w, sizeof(w));
+}
+#endif
+
+/* Checks the arguments of the multi-buffer entry points */
+static int blake2b_multi_check(void *const *out, const void *const *in,
+                               size_t inlen, size_t count) {
+    size_t i;
+
+    if (count > 0 && (out == NULL || in == NULL)) {
+        return -1;
+    }
+    for (i = 0; i < count; ++i) {
+        if (out[i] == NULL || (in[i] == NULL && inlen > 0)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int blake2b_multi(void *const *out, size_t outlen, const void *const *in,
+                  size_t inlen, size_t count) {
+    size_t i = 0;
+
+    if (outlen == 0 || outlen > BLAKE2B_OUTBYTES ||
+        blake2b_multi_check(out, in, inlen, count) < 0) {
+        return -1;
+    }
+
+#if BLAKE2B_MULTI_LANES > 1
+    for (; i + BLAKE2B_MULTI_LANES <= count; i += BLAKE2B_MULTI_LANES) {
+        blake2b_hash_lanes((uint8_t *const *)(out + i), outlen, NULL, 0,
+                           (const uint8_t *const *)(in + i), inlen);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        if (blake2b(out[i], outlen, in[i], inlen, NULL, 0) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int blake2b_long_multi(void *const *out, size_t outlen, const void *const *in,
+                       size_t inlen, size_t count) {
+    size_t i = 0;
+
+    if (outlen == 0 || outlen > UINT32_MAX ||
+        blake2b_multi_check(out, in, inlen, count) < 0) {
+        return -1;
+    }
+
+#if BLAKE2B_MULTI_LANES > 1
+    for (; i + BLAKE2B_MULTI_LANES <= count; i += BLAKE2B_MULTI_LANES) {
+        blake2b_long_lanes((uint8_t *const *)(out + i), outlen,
+                           (const uint8_t *const *)(in + i), inlen);
+    }
+#endif
+
+    /* Tail that does not fill a whole group */
+    for (; i < count; ++i) {
+        if (blake2b_long(out[i], outlen, in[i], inlen) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+size_t blake2b_multi_lanes(void) { return BLAKE2B_MULTI_LANES; }
 /* Argon2 Team - End Code */
@@ -0,0 +1,374 @@
+/*
+ * Argon2 source code package
+ *
+ * This work is licensed under a Creative Commons CC0 1.0 License/Waiver.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along with
+ * this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define API_TEST_POSIX
+#endif
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+#include "argon2.h"
+
+/*
+ * Checks of library paths that the test vectors do not reach: they must agree with the single-call functions and
+ * report what they did through the metrics. Prints every failed check and exits with 1 if there was any.
+ */
+
+static unsigned failures = 0;
+
+static void Check(bool condition, const char *what) {
+    if (!condition) {
+        printf("API test failed: %s\n", what);
+        failures++;
+    }
+}
+
+/* One stored hash of VerifyEncodedBatch() and the password that is checked against it */
+struct BatchEntry {
+    Argon2_type type;
+    uint32_t m_cost, t_cost, lanes;
+    const char *stored; //password the hash is made of
+    const char *given; //password that is verified
+};
+
+/*
+ * Writes the PHC string of @a entry
+ * @return ARGON2_OK or the error of hashing or encoding
+ */
+static int EncodeEntry(const BatchEntry &entry, char *encoded, size_t encoded_len) {
+    uint8_t tag[32], salt[16];
+    memset(salt, 0x5A, sizeof(salt));
+    Argon2_Context context(tag, sizeof(tag), (uint8_t *) entry.stored, (uint32_t) strlen(entry.stored), salt,
+            sizeof(salt), NULL, 0, NULL, 0, entry.t_cost, entry.m_cost, entry.lanes, entry.lanes, NULL, NULL, false,
+            false, false, false);
+    int result = (Argon2_i == entry.type) ? Argon2i(&context) : (Argon2_id == entry.type) ? Argon2id(&context)
+                                                                                        : Argon2d(&context);
+    if (ARGON2_OK != result) {
+        return result;
+    }
+    Argon2_EncodedHash fields;
+    memset(&fields, 0, sizeof(fields));
+    fields.type = entry.type;
+    fields.m_cost = entry.m_cost;
+    fields.t_cost = entry.t_cost;
+    fields.lanes = entry.lanes;
+    fields.salt = salt;
+    fields.saltlen = sizeof(salt);
+    fields.hash = tag;
+    fields.hashlen = sizeof(tag);
+    return EncodeHash(encoded, encoded_len, &fields);
+}
+
+/*
+ * VerifyEncodedBatch() with groups of Argon2i and Argon2id entries of the same parameters: the groups share an
+ * address table, and every result is the one of VerifyEncoded()
+ */
+static void TestVerifyBatch() {
+    static const BatchEntry entries[] = {
+        {Argon2_i, 64, 2, 2, "password0", "password0"},
+        {Argon2_id, 64, 2, 2, "password1", "password1"},
+        {Argon2_i, 64, 2, 2, "password2", "password2"},
+        {Argon2_id, 64, 2, 2, "password3", "wrong"},
+        {Argon2_i, 64, 2, 2, "password4", "wrong"},
+        {Argon2_i, 128, 1, 1, "password5", "password5"}, // alone with its parameters
+        {Argon2_d, 64, 2, 2, "password6", "password6"}, // data-dependent, no table
+        {Argon2_d, 64, 2, 2, "password7", "password7"},
+        {Argon2_id, 64, 2, 2, "password8", "password8"},
+        {Argon2_i, 64, 2, 2, "password9", "password9"},
+    };
+    const uint32_t count = sizeof(entries) / sizeof(entries[0]);
+    const uint64_t shared = 7; // the four Argon2i and three Argon2id entries of 64 KiB, 2 passes and 2 lanes
+
+    char encoded[count][256];
+    const char *encoded_ptrs[count];
+    const uint8_t *pwds[count];
+    uint32_t pwdlens[count];
+    int expected[count];
+    for (uint32_t k = 0; k < count; ++k) {
+        Check(ARGON2_OK == EncodeEntry(entries[k], encoded[k], sizeof(encoded[k])), "encoding a batch entry");
+        encoded_ptrs[k] = encoded[k];
+        pwds[k] = (const uint8_t *) entries[k].given;
+        pwdlens[k] = (uint32_t) strlen(entries[k].given);
+        expected[k] = VerifyEncoded(encoded[k], pwds[k], pwdlens[k]);
+        Check((ARGON2_OK == expected[k]) == !strcmp(entries[k].stored, entries[k].given), "VerifyEncoded result");
+    }
+
+    for (uint32_t threads = 1; threads <= 3; threads += 2) {
+        Argon2_Metrics before, after;
+        int results[count];
+        GetMetrics(&before);
+        VerifyEncodedBatch(encoded_ptrs, pwds, pwdlens, count, threads, NULL, results);
+        GetMetrics(&after);
+        for (uint32_t k = 0; k < count; ++k) {
+            Check(results[k] == expected[k], "VerifyEncodedBatch result differs from VerifyEncoded");
+        }
+        Check(after.shared_address_tables - before.shared_address_tables == shared,
+                "VerifyEncodedBatch entries verified with a shared address table");
+    }
+}
+
+/*
+ * EncodeString() writes only strings that VerifyEncoded() accepts: salt and associated data given as parts are
+ * gathered, and a tag in an output stream or associated data beyond ARGON2_ENCODED_MAX_DATA_LENGTH is refused
+ */
+static void TestEncodeString() {
+    uint8_t tag[32], salt[16], pwd[8], ad[ARGON2_ENCODED_MAX_DATA_LENGTH + 1];
+    memset(salt, 0x5A, sizeof(salt));
+    memset(pwd, 0x01, sizeof(pwd));
+    memset(ad, 0x33, sizeof(ad));
+    char encoded[256];
+
+    Argon2_Context plain(tag, sizeof(tag), pwd, sizeof(pwd), salt, sizeof(salt), NULL, 0, ad, 16, 2, 64, 1, 1, NULL,
+            NULL, false, false, false, false);
+    Check(ARGON2_OK == Argon2id(&plain), "Argon2id() with contiguous inputs");
+    Check(ARGON2_OK == EncodeString(encoded, sizeof(encoded), Argon2_id, &plain) &&
+            ARGON2_OK == VerifyEncoded(encoded, pwd, sizeof(pwd)), "EncodeString() round trip");
+
+    const Argon2_InputPart salt_parts[] = {{salt, 5}, {NULL, 0}, {salt + 5, 11}};
+    const Argon2_InputPart ad_parts[] = {{ad, 10}, {ad + 10, 6}};
+    Argon2_Context parts(tag, sizeof(tag), pwd, sizeof(pwd), NULL, 0, NULL, 0, NULL, 0, 2, 64, 1, 1, NULL, NULL, false,
+            false, false, false);
+    parts.salt_parts = salt_parts;
+    parts.salt_parts_count = 3;
+    parts.ad_parts = ad_parts;
+    parts.ad_parts_count = 2;
+    memset(tag, 0, sizeof(tag));
+    Check(ARGON2_OK == Argon2id(&parts), "Argon2id() with salt and associated data parts");
+    char from_parts[256];
+    Check(ARGON2_OK == EncodeString(from_parts, sizeof(from_parts), Argon2_id, &parts) &&
+            ARGON2_OK == VerifyEncoded(from_parts, pwd, sizeof(pwd)), "EncodeString() round trip of parts");
+    Check(0 == strcmp(encoded, from_parts), "EncodeString() of parts is the one of the contiguous inputs");
+
+    Argon2_OutputStream *stream = CreateOutputStream();
+    Argon2_Context streamed(NULL, sizeof(tag), pwd, sizeof(pwd), salt, sizeof(salt), NULL, 0, NULL, 0, 2, 64, 1, 1, NULL,
+            NULL, false, false, false, false);
+    streamed.output_stream = stream;
+    Check(ARGON2_OK == Argon2id(&streamed), "Argon2id() into an output stream");
+    Check(ARGON2_ENCODING_FAIL == EncodeString(encoded, sizeof(encoded), Argon2_id, &streamed),
+            "EncodeString() refuses a tag in an output stream");
+    DestroyOutputStream(stream);
+
+    Argon2_Context long_ad(tag, sizeof(tag), pwd, sizeof(pwd), salt, sizeof(salt), NULL, 0, ad, sizeof(ad), 2, 64, 1, 1,
+            NULL, NULL, false, false, false, false);
+    Check(ARGON2_OK == Argon2id(&long_ad), "Argon2id() with long associated data");
+    Check(ARGON2_ENCODING_FAIL == EncodeString(encoded, sizeof(encoded), Argon2_id, &long_ad),
+            "EncodeString() refuses associated data that VerifyEncoded() can not decode");
+}
+
+/*
+ * A hash with a key id was computed with a secret that VerifyEncoded() and VerifyEncodedBatch() do not have: the right
+ * password must give ARGON2_SECRET_REQUIRED, not a mismatch
+ */
+static void TestKeyedHash() {
+    uint8_t tag[32], salt[16], pwd[8], secret[16], keyid[4] = {1, 2, 3, 4};
+    memset(salt, 0x5A, sizeof(salt));
+    memset(pwd, 0x01, sizeof(pwd));
+    memset(secret, 0x77, sizeof(secret));
+    Argon2_Context context(tag, sizeof(tag), pwd, sizeof(pwd), salt, sizeof(salt), secret, sizeof(secret), NULL, 0, 2,
+            64, 1, 1, NULL, NULL, false, false, false, false);
+    Check(ARGON2_OK == Argon2i(&context), "Argon2i() with a secret");
+    Argon2_EncodedHash fields;
+    memset(&fields, 0, sizeof(fields));
+    fields.type = Argon2_i;
+    fields.m_cost = 64;
+    fields.t_cost = 2;
+    fields.lanes = 1;
+    fields.keyid = keyid;
+    fields.keyidlen = sizeof(keyid);
+    fields.salt = salt;
+    fields.saltlen = sizeof(salt);
+    fields.hash = tag;
+    fields.hashlen = sizeof(tag);
+    char encoded[256];
+    Check(ARGON2_OK == EncodeHash(encoded, sizeof(encoded), &fields), "encoding a keyed hash");
+
+    Check(ARGON2_SECRET_REQUIRED == VerifyEncoded(encoded, pwd, sizeof(pwd)), "VerifyEncoded() of a keyed hash");
+    const char *encoded_ptrs[] = {encoded};
+    const uint8_t *pwds[] = {pwd};
+    const uint32_t pwdlens[] = {sizeof(pwd)};
+    int result = ARGON2_OK;
+    Check(ARGON2_SECRET_REQUIRED == VerifyEncodedBatch(encoded_ptrs, pwds, pwdlens, 1, 1, NULL, &result) &&
+            ARGON2_SECRET_REQUIRED == result, "VerifyEncodedBatch() of a keyed hash");
+}
+
+/*
+ * NeedsRehash() reports a hash of another version as needing a rehash, not as malformed
+ */
+static void TestNeedsRehashVersion() {
+    const Argon2_RehashPolicy policy = {Argon2_i, 64, 2, 1, 32, 16};
+    const char *current = "$argon2i$m=64,t=2,p=1$WlpaWlpaWlpaWlpaWlpaWg$"
+            "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8";
+    const char *explicit_current = "$argon2i$v=16$m=64,t=2,p=1$WlpaWlpaWlpaWlpaWlpaWg$"
+            "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8";
+    const char *other = "$argon2i$v=19$m=64,t=2,p=1$WlpaWlpaWlpaWlpaWlpaWg$"
+            "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8";
+    bool needs_rehash = true;
+    Check(ARGON2_OK == NeedsRehash(current, &policy, &needs_rehash) && !needs_rehash,
+            "NeedsRehash() of a hash that meets the policy");
+    needs_rehash = true;
+    Check(ARGON2_OK == NeedsRehash(explicit_current, &policy, &needs_rehash) && !needs_rehash,
+            "NeedsRehash() of a hash with the current version");
+    needs_rehash = false;
+    Check(ARGON2_OK == NeedsRehash(other, &policy, &needs_rehash) && needs_rehash,
+            "NeedsRehash() of a hash of another version");
+    Check(ARGON2_DECODING_FAIL == VerifyEncoded(other, (const uint8_t *) "pwd", 3),
+            "VerifyEncoded() of a hash of another version");
+}
+
+/* Sum of the per-type entries of a metrics array */
+static uint64_t SumTypes(const uint64_t *values) {
+    uint64_t sum = 0;
+    for (uint32_t t = 0; t < ARGON2_METRICS_TYPES; ++t) {
+        sum += values[t];
+    }
+    return sum;
+}
+
+/*
+ * Every started hash is counted as completed or failed, also when the type is invalid or the inputs are rejected
+ */
+static void TestMetricsFailures() {
+    uint8_t tag[32], salt[16], pwd[8];
+    memset(salt, 0x5A, sizeof(salt));
+    memset(pwd, 0x01, sizeof(pwd));
+    Argon2_Metrics before, after;
+    GetMetrics(&before);
+
+    Argon2_Context context(tag, sizeof(tag), pwd, sizeof(pwd), salt, sizeof(salt), NULL, 0, NULL, 0, 1, 64, 1, 1,
+            NULL, NULL, false, false, false, false);
+    Check(ARGON2_INCORRECT_TYPE == Verify((Argon2_type) 7, &context, tag), "Verify() with an invalid type");
+    Argon2_Context invalid(tag, sizeof(tag), pwd, sizeof(pwd), salt, sizeof(salt), NULL, 0, NULL, 0, 0, 64, 1, 1,
+            NULL, NULL, false, false, false, false);
+    Check(ARGON2_OK != Argon2i(&invalid), "Argon2i() with zero passes");
+    Check(ARGON2_OK == Argon2id(&context), "Argon2id()");
+
+    GetMetrics(&after);
+    const uint64_t started = SumTypes(after.hashes_started) - SumTypes(before.hashes_started);
+    const uint64_t completed = SumTypes(after.hashes_completed) - SumTypes(before.hashes_completed);
+    const uint64_t failed = SumTypes(after.hashes_failed) - SumTypes(before.hashes_failed);
+    Check(3 == started && started == completed + failed, "started hashes are counted as completed or failed");
+    Check(1 == after.hashes_failed[ARGON2_METRICS_UNKNOWN_TYPE] - before.hashes_failed[ARGON2_METRICS_UNKNOWN_TYPE],
+            "a hash of an invalid type is counted as failed");
+    Check(1 == after.hashes_failed[Argon2_i] - before.hashes_failed[Argon2_i],
+            "a rejected Argon2i hash is counted as failed");
+}
+
+#ifdef API_TEST_POSIX
+/*
+ * The backing file is a new unnamed file in the given directory: the tag is the one of memory in RAM, nothing is left
+ * in the directory, and a path that names an existing file is rejected without touching the file
+ */
+static void TestBackingFile() {
+    char directory[] = "/tmp/argon2-api-test-XXXXXX";
+    if (NULL == mkdtemp(directory)) {
+        Check(false, "creating a directory for the backing file");
+        return;
+    }
+    uint8_t tags[2][32], salt[16], pwd[8];
+    memset(salt, 0x5A, sizeof(salt));
+    memset(pwd, 0x01, sizeof(pwd));
+    for (int file = 0; file < 2; ++file) {
+        Argon2_Context context(tags[file], sizeof(tags[file]), pwd, sizeof(pwd), salt, sizeof(salt), NULL, 0, NULL, 0,
+                2, 256, 2, 2, NULL, NULL, false, false, false, false);
+        context.backing_file = file ? directory : NULL;
+        Check(ARGON2_OK == Argon2i(&context), "Argon2i() with memory in RAM and in a backing file");
+    }
+    Check(0 == memcmp(tags[0], tags[1], sizeof(tags[0])), "the tag of the backing file is the tag in RAM");
+
+    std::string path = std::string(directory) + "/existing";
+    FILE *existing = fopen(path.c_str(), "w");
+    Check(NULL != existing && 5 == fwrite("data\n", 1, 5, existing), "writing a file");
+    if (NULL != existing) {
+        fclose(existing);
+    }
+    Argon2_Context context(tags[0], sizeof(tags[0]), pwd, sizeof(pwd), salt, sizeof(salt), NULL, 0, NULL, 0, 2, 256, 2,
+            2, NULL, NULL, false, false, false, false);
+    context.backing_file = path.c_str();
+    Check(ARGON2_BACKING_FILE_ERROR == Argon2i(&context), "a backing file path that names a file is rejected");
+    char content[8] = {0};
+    existing = fopen(path.c_str(), "r");
+    Check(NULL != existing && 5 == fread(content, 1, sizeof(content), existing) && !strcmp(content, "data\n"),
+            "the file named as backing file is kept");
+    if (NULL != existing) {
+        fclose(existing);
+    }
+    unlink(path.c_str());
+    Check(0 == rmdir(directory), "the backing file leaves nothing in its directory");
+}
+#endif
+
+#ifdef __linux__
+/*
+ * Segmented mapped memory whose second lane can not be mapped: the address space is limited to the current size plus
+ * room for the first lane only. The call fails, the first lane is unmapped (not deleted) and the next call works
+ */
+static void TestFailedLaneMapping() {
+    const uint32_t lane_kib = 512 * 1024;
+    unsigned long pages = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    bool measured = NULL != statm && 1 == fscanf(statm, "%lu", &pages);
+    if (NULL != statm) {
+        fclose(statm);
+    }
+    struct rlimit saved, limited;
+    if (!measured || 0 != getrlimit(RLIMIT_AS, &saved)) {
+        Check(false, "measuring the address space");
+        return;
+    }
+    limited = saved;
+    limited.rlim_cur = (rlim_t) pages * sysconf(_SC_PAGESIZE) + (rlim_t) lane_kib * 1024 * 3 / 2;
+    if (saved.rlim_max != RLIM_INFINITY && limited.rlim_cur > saved.rlim_max) {
+        return; // the hard limit is lower, nothing to test
+    }
+
+    uint8_t tag[32], salt[16], pwd[8];
+    memset(salt, 0x5A, sizeof(salt));
+    memset(pwd, 0x01, sizeof(pwd));
+    Argon2_Context context(tag, sizeof(tag), pwd, sizeof(pwd), salt, sizeof(salt), NULL, 0, NULL, 0, 1, 2 * lane_kib, 2,
+            1, NULL, NULL, false, false, false, false);
+    context.map_memory = true;
+    context.segmented_memory = true;
+    Check(0 == setrlimit(RLIMIT_AS, &limited), "limiting the address space");
+    const int result = Argon2d(&context);
+    setrlimit(RLIMIT_AS, &saved);
+    Check(ARGON2_MEMORY_ALLOCATION_ERROR == result, "a lane that can not be mapped fails the call");
+
+    Argon2_Context small(tag, sizeof(tag), pwd, sizeof(pwd), salt, sizeof(salt), NULL, 0, NULL, 0, 1, 256, 2, 1, NULL,
+            NULL, false, false, false, false);
+    small.map_memory = true;
+    small.segmented_memory = true;
+    Check(ARGON2_OK == Argon2d(&small), "segmented mapped memory after a failed mapping");
+}
+#endif
+
+int main() {
+    TestVerifyBatch();
+    TestMetricsFailures();
+    TestEncodeString();
+    TestKeyedHash();
+    TestNeedsRehashVersion();
+#ifdef API_TEST_POSIX
+    TestBackingFile();
+#endif
+#ifdef __linux__
+    TestFailedLaneMapping();
+#endif
+
+    printf("API tests: %u failures\n", failures);
+    return (0 == failures) ? 0 : 1;
+}
@@ -9,6 +9,10 @@
  * this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include <stdio.h>
@@ -16,87 +20,611 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#ifdef _MSC_VER
-#include <intrin.h>
-#endif
 
 #include "argon2.h"
+#include "blake2.h"
+#include "cycles.h"
+#include "perf-counters.h"
 
-static uint64_t rdtsc(void) {
-#ifdef _MSC_VER
-    return __rdtsc();
-#else
-#if defined(__amd64__) || defined(__x86_64__)
-    uint64_t rax, rdx;
-    __asm__ __volatile__("rdtsc" : "=a"(rax), "=d"(rdx) : :);
-    return (rdx << 32) | rax;
-#elif defined(__i386__) || defined(__i386) || defined(__X86__)
-    uint64_t rax;
-    __asm__ __volatile__("rdtsc" : "=A"(rax) : :);
-    return rax;
-#else
-#error "Not implemented!"
-#endif
-#endif
+/*
+ * Points of the benchmark matrix and how every point is measured
+ */
+struct BenchmarkConfig {
+    std::vector<Argon2_type> types; //Argon2 types
+    std::vector<uint32_t> m_costs; //memory in KiB
+    std::vector<uint32_t> t_costs; //number of passes
+    std::vector<uint32_t> threads; //number of threads
+    uint32_t lanes; //number of lanes, 0 to use the number of threads
+    uint32_t warmups; //runs before the measured ones
+    uint32_t repeats; //measured runs
+    const char* format; //"text", "json" or "csv"
+    bool roofline; //compare every point with the measured memory bandwidth, see RooflineBenchmark()
+    const PerfCounters* counters; //hardware counters read around every run, NULL to measure time only
+};
+
+/*
+ * Statistics of the measured runs of one point
+ */
+struct BenchmarkResult {
+    Argon2_type type;
+    uint32_t m_cost, t_cost, lanes, threads;
+    double min, median, p95, p99; //wall time in seconds
+    double cpb; //median cycles per byte of memory and pass
+    double per_block[PERF_COUNTERS]; //median hardware events per block and pass, negative if not counted
+    double barrier_wait; //median fraction of the thread time spent waiting at the sync points
+    double lane_spread; //median ratio of the slowest to the fastest lane compute time
+};
+
+static const char* TypeName(Argon2_type type) {
+    switch (type) {
+    case Argon2_d:
+        return "Argon2d";
+    case Argon2_i:
+        return "Argon2i";
+    case Argon2_id:
+        return "Argon2id";
+    case Argon2_ds:
+        return "Argon2ds";
+    }
+    return "unknown";
 }
 
 /*
- * Benchmarks Argon2 with salt length 16, password length 32, t_cost 3, and different threads and m_cost
+ * Value below which @a fraction of the sorted @a values lie (nearest rank)
  */
-void Benchmark() {
+static double Percentile(const std::vector<double>& values, double fraction) {
+    return values[(size_t) (fraction * (values.size() - 1) + 0.5)];
+}
+
+/*
+ * Runs one point of the matrix: @a warmups discarded runs, then @a repeats measured ones, each with a fresh context
+ * @return ARGON2_OK or the error code of the first failed run
+ */
+static int BenchmarkPoint(const BenchmarkConfig& config, BenchmarkResult* result) {
     const uint32_t inlen = 16;
-    const unsigned outlen=16;
+    const unsigned outlen = 16;
     unsigned char out[outlen];
     unsigned char pwd_array[inlen];
     unsigned char salt_array[inlen];
 
+    std::vector<double> seconds, cycles, events[PERF_COUNTERS], waits, spreads;
+    PerfSample start_sample, stop_sample;
+    Argon2_Stats stats;
+    std::vector<uint64_t> lane_ns(result->lanes);
+    stats.lane_ns = lane_ns.data();
+    stats.lane_capacity = result->lanes;
+    for (uint32_t r = 0; r < config.warmups + config.repeats; ++r) {
+        memset(pwd_array, 0, inlen);
+        memset(salt_array, 1, inlen);
+        Argon2_Context context(out, outlen, pwd_array, inlen, salt_array, inlen, NULL, 0, NULL, 0,
+                result->t_cost, result->m_cost, result->lanes, result->threads, NULL, NULL, false, false, false, false);
+        context.stats = &stats;
+
+        if (config.counters) {
+            config.counters->Read(&start_sample);
+        }
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        uint64_t start_cycles = rdtsc();
+        int code;
+        switch (result->type) {
+        case Argon2_d:
+            code = Argon2d(&context);
+            break;
+        case Argon2_i:
+            code = Argon2i(&context);
+            break;
+        case Argon2_id:
+            code = Argon2id(&context);
+            break;
+        default:
+            code = Argon2ds(&context);
+            break;
+        }
+        uint64_t stop_cycles = rdtsc();
+        std::chrono::steady_clock::time_point stop_time = std::chrono::steady_clock::now();
+        if (config.counters) {
+            config.counters->Read(&stop_sample);
+        }
+        if (code != ARGON2_OK) {
+            return code;
+        }
+        if (r >= config.warmups) {
+            seconds.push_back(std::chrono::duration<double>(stop_time - start_time).count());
+            cycles.push_back((double) (stop_cycles - start_cycles));
+            for (int i = 0; config.counters && i < PERF_COUNTERS; ++i) {
+                events[i].push_back(config.counters->Delta(start_sample, stop_sample, i));
+            }
+            uint64_t wait_ns = 0;
+            for (uint32_t s = 0; s < ARGON2_SYNC_POINTS; ++s) {
+                wait_ns += stats.barrier_wait_ns[s];
+            }
+            waits.push_back(stats.slices_ns ? (double) wait_ns / ((double) stats.threads * stats.slices_ns) : 0);
+            const uint64_t slowest = *std::max_element(lane_ns.begin(), lane_ns.end());
+            const uint64_t fastest = *std::min_element(lane_ns.begin(), lane_ns.end());
+            spreads.push_back(fastest ? (double) slowest / fastest : 1);
+        }
+    }
+
+    std::sort(seconds.begin(), seconds.end());
+    std::sort(cycles.begin(), cycles.end());
+    std::sort(waits.begin(), waits.end());
+    std::sort(spreads.begin(), spreads.end());
+    result->min = seconds.front();
+    result->median = Percentile(seconds, 0.5);
+    result->p95 = Percentile(seconds, 0.95);
+    result->p99 = Percentile(seconds, 0.99);
+    result->cpb = Percentile(cycles, 0.5) / ((double) result->m_cost * 1024 * result->t_cost);
+    for (int i = 0; i < PERF_COUNTERS; ++i) {
+        std::sort(events[i].begin(), events[i].end());
+        const bool counted = !events[i].empty() && events[i].front() >= 0;
+        result->per_block[i] = counted ? Percentile(events[i], 0.5) / ((double) result->m_cost * result->t_cost) : -1;
+    }
+    result->barrier_wait = Percentile(waits, 0.5);
+    result->lane_spread = Percentile(spreads, 0.5);
+    return ARGON2_OK;
+}
+
+static void PrintResult(const BenchmarkConfig& config, const BenchmarkResult& r, bool first) {
+    if (!strcmp(config.format, "csv")) {
+        printf("%s,%s,%s,%u,%u,%u,%u,%u,%.6f,%.6f,%.6f,%.6f,%.3f,%.4f,%.3f", ARGON2_IMPLEMENTATION,
+                blake2b_implementation(), TypeName(r.type), r.m_cost, r.t_cost, r.lanes, r.threads, config.repeats, r.min,
+                r.median, r.p95, r.p99, r.cpb, r.barrier_wait, r.lane_spread);
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+            if (r.per_block[i] >= 0) {
+                printf(",%.3f", r.per_block[i]);
+            } else {
+                printf(","); // not counted
+            }
+        }
+        printf("\n");
+    } else if (!strcmp(config.format, "json")) {
+        printf("%s\n    {\"type\": \"%s\", \"m_cost\": %u, \"t_cost\": %u, \"lanes\": %u, \"threads\": %u, "
+                "\"min_s\": %.6f, \"median_s\": %.6f, \"p95_s\": %.6f, \"p99_s\": %.6f, \"cpb\": %.3f, "
+                "\"barrier_wait\": %.4f, \"lane_spread\": %.3f", first ? "" : ",", TypeName(r.type), r.m_cost,
+                r.t_cost, r.lanes, r.threads, r.min, r.median, r.p95, r.p99, r.cpb, r.barrier_wait, r.lane_spread);
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+            if (r.per_block[i] >= 0) {
+                printf(", \"%s_per_block\": %.3f", PERF_COUNTER_NAMES[i], r.per_block[i]);
+            } else {
+                printf(", \"%s_per_block\": null", PERF_COUNTER_NAMES[i]);
+            }
+        }
+        printf("}");
+    } else {
+        printf("%s %u pass(es)  %u Mbytes %u lanes %u threads:  min %2.4f s  median %2.4f s  p95 %2.4f s  "
+                "p99 %2.4f s  %2.2f cpb  wait %.1f%%  lanes max/min %.2f", TypeName(r.type), r.t_cost, r.m_cost >> 10,
+                r.lanes, r.threads, r.min, r.median, r.p95, r.p99, r.cpb, 100 * r.barrier_wait, r.lane_spread);
+        if (config.counters && config.counters->AnyAvailable()) {
+            const char* labels[PERF_COUNTERS] = {"instr", "LLC miss", "dTLB miss", "stalled"};
+            printf("  per block:");
+            for (int i = 0; i < PERF_COUNTERS; ++i) {
+                if (r.per_block[i] >= 0) {
+                    printf("  %.2f %s", r.per_block[i], labels[i]);
+                } else {
+                    printf("  n/a %s", labels[i]);
+                }
+            }
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+/*
+ * Benchmarks every combination of the configured types, memory sizes, passes and threads
+ * @return ARGON2_OK or the error code of the first failed point
+ */
+int Benchmark(const BenchmarkConfig& config) {
+    if (!strcmp(config.format, "csv")) {
+        printf("implementation,blake2b,type,m_cost,t_cost,lanes,threads,repeats,min_s,median_s,p95_s,p99_s,cpb,"
+                "barrier_wait,lane_spread");
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+            printf(",%s_per_block", PERF_COUNTER_NAMES[i]);
+        }
+        printf("\n");
+    } else if (!strcmp(config.format, "json")) {
+        printf("{\"implementation\": \"%s\", \"blake2b\": \"%s\", \"warmups\": %u, \"repeats\": %u, \"results\": [",
+                ARGON2_IMPLEMENTATION, blake2b_implementation(), config.warmups, config.repeats);
+    } else {
+        printf("Implementation: %s, BLAKE2b: %s, %u warm-up and %u measured runs per point\n\n", ARGON2_IMPLEMENTATION,
+                blake2b_implementation(), config.warmups, config.repeats);
+    }
+    if (config.counters && !config.counters->AnyAvailable()) {
+        fprintf(stderr, "Hardware counters are not available (see perf_event_paranoid), measuring time only\n");
+    }
+
+    bool first = true;
+    int code = ARGON2_OK;
+    for (uint32_t m_cost : config.m_costs) {
+        for (uint32_t t_cost : config.t_costs) {
+            for (uint32_t thread_n : config.threads) {
+                for (Argon2_type type : config.types) {
+                    BenchmarkResult result = BenchmarkResult();
+                    result.type = type;
+                    result.m_cost = m_cost;
+                    result.t_cost = t_cost;
+                    result.threads = thread_n;
+                    result.lanes = config.lanes ? config.lanes : thread_n;
+                    int point_code = BenchmarkPoint(config, &result);
+                    if (point_code != ARGON2_OK) {
+                        fprintf(stderr, "Error: %s m_cost %u t_cost %u lanes %u threads %u: %s\n", TypeName(type),
+                                m_cost, t_cost, result.lanes, thread_n, ErrorMessage(point_code));
+                        // The other points still run, the first error is the result of the sweep
+                        code = (code == ARGON2_OK) ? point_code : code;
+                        continue;
+                    }
+                    PrintResult(config, result, first);
+                    first = false;
+                }
+            }
+        }
+    }
+
+    if (!strcmp(config.format, "json")) {
+        printf("\n]}\n");
+    }
+    return code;
+}
+
+/* Bytes of memory traffic per block: the previous and the reference block are read, the new one is written */
+const double ROOFLINE_BYTES_PER_BLOCK = 3.0 * 1024;
+
+/* Size of the buffers the bandwidths are measured on, well beyond the last-level cache */
+const size_t ROOFLINE_BUFFER_BYTES = (size_t) 256 << 20;
+
+/*
+ * Runs @a kernel(thread) on @a threads threads
+ * @return Wall time in seconds
+ */
+template <typename Kernel>
+static double TimeThreads(uint32_t threads, Kernel kernel) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> Threads;
+    for (uint32_t t = 0; t < threads; ++t) {
+        Threads.push_back(std::thread(kernel, t));
+    }
+    for (auto& t : Threads) {
+        t.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*
+ * STREAM-style copy bandwidth: every thread copies its slice of @a src into @a dst, bytes read plus bytes written
+ * @return Best bandwidth of @a repeats copies in bytes per second
+ */
+static double CopyBandwidth(std::vector<uint64_t>& src, std::vector<uint64_t>& dst, uint32_t threads, uint32_t repeats) {
+    const size_t slice = src.size() / threads;
+    double best = 0;
+    for (uint32_t r = 0; r < repeats; ++r) {
+        double seconds = TimeThreads(threads, [&](uint32_t t) {
+            memcpy(&dst[t * slice], &src[t * slice], slice * sizeof (uint64_t));
+        });
+        best = std::max(best, 2.0 * threads * slice * sizeof (uint64_t) / seconds);
+    }
+    return best;
+}
+
+/*
+ * Bandwidth of reading 1 KiB blocks at random positions of @a memory, as Argon2 reads its reference blocks
+ * @return Best bandwidth of @a repeats rounds in bytes per second
+ */
+static double RandomReadBandwidth(const std::vector<uint64_t>& memory, uint32_t threads, uint32_t repeats) {
+    const uint32_t words = 1024 / sizeof (uint64_t);
+    const size_t blocks = memory.size() / words;
+    const uint32_t reads = 1 << 16; //per thread
+    double best = 0;
+    for (uint32_t r = 0; r < repeats; ++r) {
+        volatile uint64_t sink = 0;
+        double seconds = TimeThreads(threads, [&](uint32_t t) {
+            uint64_t state = 0x9E3779B97F4A7C15ULL * (t + 1), sum = 0;
+            for (uint32_t i = 0; i < reads; ++i) {
+                state ^= state << 13; // xorshift64
+                state ^= state >> 7;
+                state ^= state << 17;
+                const uint64_t* block = &memory[(state % blocks) * words];
+                for (uint32_t j = 0; j < words; ++j) {
+                    sum += block[j];
+                }
+            }
+            sink += sum;
+        });
+        best = std::max(best, (double) threads * reads * 1024 / seconds);
+    }
+    return best;
+}
+
+/*
+ * Roofline report: measures the copy and random-read bandwidth of the host, and the rate of Argon2 in 256 KiB that fit in
+ * the caches, then runs every point of the matrix. A point moves ROOFLINE_BYTES_PER_BLOCK per block; its memory roof
+ * is that traffic at the measured rates (the reference block at the random-read bandwidth, the rest at the copy
+ * bandwidth), its compute roof the in-cache rate. The lower roof tells whether the point is memory- or compute-bound
+ * @return ARGON2_OK or the error code of the first failed point
+ */
+int RooflineBenchmark(const BenchmarkConfig& config) {
+    // The bandwidths of every thread count are measured first, so that the buffers are released before the points run
+    std::vector<double> copy(config.threads.size()), random_read(config.threads.size());
+    {
+        std::vector<uint64_t> src(ROOFLINE_BUFFER_BYTES / sizeof (uint64_t), 1), dst(src.size(), 0);
+        for (size_t n = 0; n < config.threads.size(); ++n) {
+            copy[n] = CopyBandwidth(src, dst, config.threads[n], 5);
+            random_read[n] = RandomReadBandwidth(src, config.threads[n], 5);
+        }
+    }
+
+    if (!strcmp(config.format, "csv")) {
+        printf("implementation,blake2b,type,m_cost,t_cost,lanes,threads,median_s,achieved_gbs,copy_gbs,random_read_gbs,"
+                "memory_roof_gbs,compute_roof_gbs,fraction,bound\n");
+    } else if (!strcmp(config.format, "json")) {
+        printf("{\"implementation\": \"%s\", \"blake2b\": \"%s\", \"bytes_per_block\": %.0f, \"results\": [",
+                ARGON2_IMPLEMENTATION, blake2b_implementation(), ROOFLINE_BYTES_PER_BLOCK);
+    } else {
+        printf("Implementation: %s, BLAKE2b: %s, %.0f bytes of traffic per block\n\n", ARGON2_IMPLEMENTATION,
+                blake2b_implementation(), ROOFLINE_BYTES_PER_BLOCK);
+    }
+
+    bool first = true;
+    for (size_t n = 0; n < config.threads.size(); ++n) {
+        const uint32_t thread_n = config.threads[n];
+        const double memory_roof = ROOFLINE_BYTES_PER_BLOCK / (1024 / random_read[n] + 2048 / copy[n]);
+        if (!strcmp(config.format, "text")) {
+            printf("%u threads: copy %.2f GB/s, random 1 KiB read %.2f GB/s, memory roof %.2f GB/s\n", thread_n,
+                    copy[n] / 1e9, random_read[n] / 1e9, memory_roof / 1e9);
+        }
+
+        for (Argon2_type type : config.types) {
+            BenchmarkResult in_cache = BenchmarkResult();
+            in_cache.type = type;
+            in_cache.m_cost = 256;
+            in_cache.t_cost = *std::max_element(config.t_costs.begin(), config.t_costs.end());
+            in_cache.threads = thread_n;
+            in_cache.lanes = config.lanes ? config.lanes : thread_n;
+            int code = BenchmarkPoint(config, &in_cache);
+            if (code != ARGON2_OK) {
+                fprintf(stderr, "Error: %s in cache: %s\n", TypeName(type), ErrorMessage(code));
+                return code;
+            }
+            const double compute_roof = (double) in_cache.m_cost * in_cache.t_cost * ROOFLINE_BYTES_PER_BLOCK / in_cache.median;
+
+            for (uint32_t m_cost : config.m_costs) {
+                for (uint32_t t_cost : config.t_costs) {
+                    BenchmarkResult r = BenchmarkResult();
+                    r.type = type;
+                    r.m_cost = m_cost;
+                    r.t_cost = t_cost;
+                    r.threads = thread_n;
+                    r.lanes = in_cache.lanes;
+                    code = BenchmarkPoint(config, &r);
+                    if (code != ARGON2_OK) {
+                        fprintf(stderr, "Error: %s m_cost %u t_cost %u lanes %u threads %u: %s\n", TypeName(type),
+                                m_cost, t_cost, r.lanes, thread_n, ErrorMessage(code));
+                        return code;
+                    }
+                    const double achieved = (double) m_cost * t_cost * ROOFLINE_BYTES_PER_BLOCK / r.median;
+                    const double roof = std::min(memory_roof, compute_roof);
+                    const char* bound = (memory_roof < compute_roof) ? "memory" : "compute";
+
+                    if (!strcmp(config.format, "csv")) {
+                        printf("%s,%s,%s,%u,%u,%u,%u,%.6f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%s\n", ARGON2_IMPLEMENTATION,
+                                blake2b_implementation(), TypeName(type), m_cost, t_cost, r.lanes, thread_n, r.median,
+                                achieved / 1e9, copy[n] / 1e9, random_read[n] / 1e9, memory_roof / 1e9, compute_roof / 1e9,
+                                achieved / roof, bound);
+                    } else if (!strcmp(config.format, "json")) {
+                        printf("%s\n    {\"type\": \"%s\", \"m_cost\": %u, \"t_cost\": %u, \"lanes\": %u, \"threads\": %u, "
+                                "\"median_s\": %.6f, \"achieved_gbs\": %.3f, \"copy_gbs\": %.3f, \"random_read_gbs\": %.3f, "
+                                "\"memory_roof_gbs\": %.3f, \"compute_roof_gbs\": %.3f, \"fraction\": %.3f, \"bound\": \"%s\"}",
+                                first ? "" : ",", TypeName(type), m_cost, t_cost, r.lanes, thread_n, r.median,
+                                achieved / 1e9, copy[n] / 1e9, random_read[n] / 1e9, memory_roof / 1e9, compute_roof / 1e9,
+                                achieved / roof, bound);
+                    } else {
+                        printf("%s %u pass(es)  %u Mbytes %u lanes %u threads:  %.2f GB/s, %.0f%% of the %s roof "
+                                "(memory %.2f GB/s, compute %.2f GB/s)\n", TypeName(type), t_cost, m_cost >> 10, r.lanes,
+                                thread_n, achieved / 1e9, 100 * achieved / roof, bound, memory_roof / 1e9,
+                                compute_roof / 1e9);
+                    }
+                    fflush(stdout);
+                    first = false;
+                }
+            }
+        }
+    }
+
+    if (!strcmp(config.format, "json")) {
+        printf("\n]}\n");
+    }
+    return ARGON2_OK;
+}
+
+/*
+ * Compares Argon2i and Argon2d with memory in RAM and mapped from a backing file in @directory, 1 lane, t_cost 1.
+ * Both runs must give the same tag
+ * @return ARGON2_OK, or the error of the first failed run or ARGON2_BACKING_FILE_ERROR if the tags differ
+ */
+int BenchmarkBackingFile(const char* directory) {
+    const uint32_t inlen = 16;
+    const unsigned outlen = 16;
+    unsigned char pwd_array[inlen];
+    unsigned char salt_array[inlen];
+
     uint32_t t_cost = 1;
 
     memset(pwd_array, 0, inlen);
     memset(salt_array, 1, inlen);
-    std::vector<uint32_t> thread_test = {1, 2, 4, 6, 8, 16};
 
     for (uint32_t m_cost = (uint32_t) 1 << 18; m_cost <= (uint32_t) 1 << 22; m_cost *= 2) {
-        for (uint32_t thread_n : thread_test) {
-
-            uint64_t start_cycles, stop_cycles, stop_cycles_i, stop_cycles_di, stop_cycles_ds;
-          
-            clock_t start_time = clock();
-            start_cycles = rdtsc();
-
-            Argon2_Context context(out, outlen, pwd_array, inlen, salt_array, inlen, NULL, 0, NULL, 0, 
-                    t_cost, m_cost, thread_n, thread_n,NULL,NULL,false,false, false,false);
-            Argon2d(&context);
-            stop_cycles = rdtsc();
-            Argon2i(&context);
-            stop_cycles_i = rdtsc();
-            Argon2id(&context);
-            stop_cycles_di = rdtsc();
-            Argon2ds(&context);
-            stop_cycles_ds = rdtsc();
-            clock_t stop_time = clock();
-
-            uint64_t delta_d = (stop_cycles - start_cycles) / (m_cost);
-            uint64_t delta_i = (stop_cycles_i - stop_cycles) / (m_cost);
-            uint64_t delta_id = (stop_cycles_di - stop_cycles_i) / m_cost;
-            uint64_t delta_ds = (stop_cycles_ds - stop_cycles_di) / m_cost;
-            float mcycles_d = (float) (stop_cycles - start_cycles) / (1 << 20);
-            float mcycles_i = (float) (stop_cycles_i - stop_cycles) / (1 << 20);
-            float mcycles_id = (float) (stop_cycles_di - stop_cycles_i) / (1 << 20);
-            float mcycles_ds = (float) (stop_cycles_ds - stop_cycles_di) / (1 << 20);
-            printf("Argon2d %d pass(es)  %d Mbytes %d lanes/threads:  %2.2f cpb %2.2f Mcycles \n", t_cost, m_cost >> 10, thread_n, (float) delta_d / 1024, mcycles_d);
-            printf("Argon2i %d pass(es)  %d Mbytes %d lanes/threads:  %2.2f cpb %2.2f Mcycles \n", t_cost, m_cost >> 10, thread_n, (float) delta_i / 1024, mcycles_i);
-            printf("Argon2id %d pass(es)  %d Mbytes %d lanes/threads:  %2.2f cpb %2.2f Mcycles \n", t_cost, m_cost >> 10, thread_n, (float) delta_id / 1024, mcycles_id);
-            printf("Argon2ds %d pass(es)  %d Mbytes %d lanes/threads:  %2.2f cpb %2.2f Mcycles \n", t_cost, m_cost >> 10, thread_n, (float) delta_ds / 1024, mcycles_ds);
-
-            float run_time = ((float) stop_time - start_time) / (CLOCKS_PER_SEC);
-            printf("%2.4f seconds\n\n", run_time);
+        for (int type = 0; type < 2; ++type) {
+            uint64_t cycles[2];
+            unsigned char out[2][outlen];
+            for (int file = 0; file < 2; ++file) {
+                Argon2_Context context(out[file], outlen, pwd_array, inlen, salt_array, inlen, NULL, 0, NULL, 0,
+                        t_cost, m_cost, 1, 1, NULL, NULL, false, false, false, false);
+                context.backing_file = file ? directory : NULL;
+                uint64_t start_cycles = rdtsc();
+                int result = (type == 0) ? Argon2i(&context) : Argon2d(&context);
+                cycles[file] = rdtsc() - start_cycles;
+                if (result != ARGON2_OK) {
+                    printf("Error: %s\n", ErrorMessage(result));
+                    return result;
+                }
+            }
+            if (memcmp(out[0], out[1], outlen)) {
+                printf("Error: Argon2%s %d Mbytes: the tag of the file differs from the tag in RAM\n",
+                        type == 0 ? "i" : "d", m_cost >> 10);
+                return ARGON2_BACKING_FILE_ERROR;
+            }
+            printf("Argon2%s %d pass(es)  %d Mbytes:  RAM %2.2f cpb  file %2.2f cpb  (x%2.2f)\n", type == 0 ? "i" : "d",
+                    t_cost, m_cost >> 10, (float) cycles[0] / m_cost / 1024, (float) cycles[1] / m_cost / 1024,
+                    (float) cycles[1] / cycles[0]);
         }
     }
+    return ARGON2_OK;
 }
 
 
-int main() {
-    Benchmark();
-    return ARGON2_OK;
-}
\ No newline at end of file
+void usage(const char* cmd) {
+    printf("Usage:  %s [-type d,i,id,ds] [-m N,...] [-t N,...] [-threads N,...] [-lanes N] [-impl ref|opt]\n"
+           "        [-warmup N] [-repeat N] [-format text|json|csv] [-roofline] [-nocounters]\n", cmd);
+    printf("        %s -file directory\n", cmd);
+    printf("Parameters:\n");
+    printf("\t-type\t\tArgon2 types to run (default all)\n");
+    printf("\t-m\t\tMemory sizes of 2^N KiB (default 18,19,20,21,22)\n");
+    printf("\t-t\t\tNumbers of passes (default 1)\n");
+    printf("\t-threads\tNumbers of threads (default 1,2,4,8)\n");
+    printf("\t-lanes N\tNumber of lanes (default: the number of threads)\n");
+    printf("\t-impl\t\tFails unless the binary is built with this core: ref, or opt with OPT=TRUE\n");
+    printf("\t-warmup N\tRuns before measuring each point (default 1)\n");
+    printf("\t-repeat N\tMeasured runs of each point (default 5)\n");
+    printf("\t-format\t\tOutput format (default text)\n");
+    printf("\t-roofline\tMeasures the memory bandwidth of the host first and reports every point as a fraction\n"
+           "\t\t\tof the memory or compute roof, whichever is lower\n");
+    printf("\t-nocounters\tDoes not read the hardware counters (instructions, LLC and dTLB misses, stalled cycles)\n");
+    printf("\t-file directory\tCompares memory in RAM with memory mapped from a backing file in directory, and their tags\n");
+}
+
+/*
+ * Parses a comma-separated list of numbers of at least @a minimum
+ * @return false if an element is not such a number
+ */
+static bool ParseList(const char* text, std::vector<uint32_t>* values, uint32_t minimum = 1) {
+    values->clear();
+    while (*text) {
+        char* end;
+        unsigned long value = strtoul(text, &end, 10);
+        if (end == text || *text == '-' || value < minimum || value > UINT32_MAX || (*end != ',' && *end != 0)) {
+            return false;
+        }
+        values->push_back((uint32_t) value);
+        text = (*end == ',') ? end + 1 : end;
+    }
+    return !values->empty();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2 && !strcmp(argv[1], "-file")) {
+        return BenchmarkBackingFile(argv[2]);
+    }
+
+    BenchmarkConfig config;
+    config.types = {Argon2_d, Argon2_i, Argon2_id, Argon2_ds};
+    config.m_costs = {1 << 18, 1 << 19, 1 << 20, 1 << 21, 1 << 22};
+    config.t_costs = {1};
+    config.threads = {1, 2, 4, 8};
+    config.lanes = 0;
+    config.warmups = 1;
+    config.repeats = 5;
+    config.format = "text";
+    config.roofline = false;
+    bool counters = true;
+
+    for (int i = 1; i < argc; ++i) {
+        std::vector<uint32_t> values;
+        if (!strcmp(argv[i], "-roofline")) {
+            config.roofline = true;
+            continue;
+        }
+        if (!strcmp(argv[i], "-nocounters")) {
+            counters = false;
+            continue;
+        }
+        if (i == argc - 1) {
+            usage(argv[0]);
+            return ARGON2_MISSING_ARGS;
+        }
+        const char* a = argv[i];
+        const char* value = argv[++i];
+        if (!strcmp(a, "-type")) {
+            config.types.clear();
+            for (const char* name = value; *name; ) {
+                size_t length = strcspn(name, ",");
+                std::string type(name, length);
+                if (type == "d") {
+                    config.types.push_back(Argon2_d);
+                } else if (type == "i") {
+                    config.types.push_back(Argon2_i);
+                } else if (type == "id") {
+                    config.types.push_back(Argon2_id);
+                } else if (type == "ds") {
+                    config.types.push_back(Argon2_ds);
+                } else {
+                    fprintf(stderr, "Error: unknown type %s\n", type.c_str());
+                    return ARGON2_INCORRECT_TYPE;
+                }
+                name += length + (name[length] == ',' ? 1 : 0);
+            }
+            continue;
+        }
+        if (!strcmp(a, "-format")) {
+            if (strcmp(value, "text") && strcmp(value, "json") && strcmp(value, "csv")) {
+                usage(argv[0]);
+                return ARGON2_INCORRECT_PARAMETER;
+            }
+            config.format = value;
+            continue;
+        }
+        if (!strcmp(a, "-impl")) {
+            if (strcmp(value, ARGON2_IMPLEMENTATION)) {
+                fprintf(stderr, "Error: this binary is built with the %s core, not %s\n", ARGON2_IMPLEMENTATION, value);
+                return ARGON2_INCORRECT_PARAMETER;
+            }
+            continue;
+        }
+        // Zero warm-up runs is allowed, every other number must be positive
+        if (!ParseList(value, &values, strcmp(a, "-warmup") ? 1 : 0)) {
+            usage(argv[0]);
+            return ARGON2_INCORRECT_PARAMETER;
+        }
+        // A single run configuration: there is no sweep over lanes, repeats or warm-up runs
+        if (values.size() > 1 && (!strcmp(a, "-lanes") || !strcmp(a, "-repeat") || !strcmp(a, "-warmup"))) {
+            usage(argv[0]);
+            return ARGON2_INCORRECT_PARAMETER;
+        }
+        if (!strcmp(a, "-m")) {
+            config.m_costs.clear();
+            for (uint32_t log_m : values) {
+                if (log_m > ARGON2_MAX_MEMORY_BITS) {
+                    fprintf(stderr, "Error: m_cost overflow\n");
+                    return ARGON2_MEMORY_TOO_MUCH;
+                }
+                config.m_costs.push_back(ARGON2_MIN(UINT64_C(1) << log_m, UINT32_C(0xFFFFFFFF)));
+            }
+        } else if (!strcmp(a, "-t")) {
+            config.t_costs = values;
+        } else if (!strcmp(a, "-threads")) {
+            config.threads = values;
+        } else if (!strcmp(a, "-lanes")) {
+            config.lanes = values.front();
+        } else if (!strcmp(a, "-repeat")) {
+            config.repeats = values.front();
+        } else if (!strcmp(a, "-warmup")) {
+            config.warmups = values.front();
+        } else {
+            usage(argv[0]);
+            return ARGON2_INCORRECT_PARAMETER;
+        }
+    }
+
+    // Opened before any Argon2 thread exists, so that all of them inherit the counters
+    PerfCounters perf_counters;
+    config.counters = counters ? &perf_counters : NULL;
+    return config.roofline ? RooflineBenchmark(config) : Benchmark(config);
+}
@@ -0,0 +1,226 @@
+/*
+ * Argon2 source code package
+ *
+ * This work is licensed under a Creative Commons CC0 1.0 License/Waiver.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along with
+ * this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "blake2.h"
+
+/*
+ * BLAKE2b known-answer tests for whichever compression function the build
+ * selected. KEYED entries are taken from the official blake2b-kat.txt (key
+ * 00..3f, input 00..n-1), PLAIN entries hash the input 00..n-1 ("abc" for
+ * n = 3) without a key, and LONG entries exercise the variable-length
+ * blake2b_long used by Argon2 (input 00..n-1). The multi-buffer
+ * blake2b_multi and blake2b_long_multi are checked against the scalar
+ * functions with a different input in every lane, see CheckMultiBuffer().
+ */
+
+enum Blake2bKatMode { KEYED, PLAIN, LONG };
+
+struct Blake2bKat {
+    Blake2bKatMode mode;
+    uint32_t inlen;
+    uint32_t outlen;
+    const char *hex;
+};
+
+static const Blake2bKat blake2b_kats[] = {
+    {KEYED, 0, 64,
+     "10ebb67700b1868efb4417987acf4690ae9d972fb7a590c2f02871799aaa4786"
+     "b5e996e8f0f4eb981fc214b005f42d2ff4233499391653df7aefcbc13fc51568"},
+    {KEYED, 1, 64,
+     "961f6dd1e4dd30f63901690c512e78e4b45e4742ed197c3c5e45c549fd25f2e4"
+     "187b0bc9fe30492b16b0d0bc4ef9b0f34c7003fac09a5ef1532e69430234cebd"},
+    {KEYED, 2, 64,
+     "da2cfbe2d8409a0f38026113884f84b50156371ae304c4430173d08a99d9fb1b"
+     "983164a3770706d537f49e0c916d9f32b95cc37a95b99d857436f0232c88a965"},
+    {KEYED, 3, 64,
+     "33d0825dddf7ada99b0e7e307104ad07ca9cfd9692214f1561356315e784f3e5"
+     "a17e364ae9dbb14cb2036df932b77f4b292761365fb328de7afdc6d8998f5fc1"},
+    {KEYED, 63, 64,
+     "bd965bf31e87d70327536f2a341cebc4768eca275fa05ef98f7f1b71a0351298"
+     "de006fba73fe6733ed01d75801b4a928e54231b38e38c562b2e33ea1284992fa"},
+    {KEYED, 64, 64,
+     "65676d800617972fbd87e4b9514e1c67402b7a331096d3bfac22f1abb95374ab"
+     "c942f16e9ab0ead33b87c91968a6e509e119ff07787b3ef483e1dcdccf6e3022"},
+    {KEYED, 65, 64,
+     "939fa189699c5d2c81ddd1ffc1fa207c970b6a3685bb29ce1d3e99d42f2f7442"
+     "da53e95a72907314f4588399a3ff5b0a92beb3f6be2694f9f86ecf2952d5b41c"},
+    {KEYED, 127, 64,
+     "76d2d819c92bce55fa8e092ab1bf9b9eab237a25267986cacf2b8ee14d214d73"
+     "0dc9a5aa2d7b596e86a1fd8fa0804c77402d2fcd45083688b218b1cdfa0dcbcb"},
+    {KEYED, 128, 64,
+     "72065ee4dd91c2d8509fa1fc28a37c7fc9fa7d5b3f8ad3d0d7a25626b57b1b44"
+     "788d4caf806290425f9890a3a2a35a905ab4b37acfd0da6e4517b2525c9651e4"},
+    {KEYED, 129, 64,
+     "64475dfe7600d7171bea0b394e27c9b00d8e74dd1e416a79473682ad3dfdbb70"
+     "6631558055cfc8a40e07bd015a4540dcdea15883cbbf31412df1de1cd4152b91"},
+    {KEYED, 200, 64,
+     "3095a349d245708c7cf550118703d7302c27b60af5d4e67fc978f8a4e60953c7"
+     "a04f92fcf41aee64321ccb707a895851552b1e37b00bc5e6b72fa5bcef9e3fff"},
+    {KEYED, 255, 64,
+     "142709d62e28fcccd0af97fad0f8465b971e82201dc51070faa0372aa43e9248"
+     "4be1c1e73ba10906d5d1853db6a4106e0a7bf9800d373d6dee2d46d62ef2a461"},
+    {PLAIN, 0, 64,
+     "786a02f742015903c6c6fd852552d272912f4740e15847618a86e217f71f5419"
+     "d25e1031afee585313896444934eb04b903a685b1448b755d56f701afe9be2ce"},
+    {PLAIN, 3, 64,
+     "ba80a53f981c4d0d6a2797b69f12f6e94c212f14685ac4b74b12bb6fdbffa2d1"
+     "7d87c5392aab792dc252d5de4533cc9518d38aa8dbf1925ab92386edd4009923"},
+    {PLAIN, 3, 32,
+     "bddd813c634239723171ef3fee98579b94964e3bb1cb3e427262c8c068d52319"},
+    {PLAIN, 256, 20,
+     "2433af65183f411941345962733a8860df650139"},
+    {PLAIN, 1031, 64,
+     "84662382b5d7a74f8ea78f3fddedebc1a51817f7c2658f4bee242c825e56e75c"
+     "a929468cfddacbe95eabc462f84446b57a8971459c7f1cfdb5f37ba9429e05cc"},
+    {LONG, 72, 32,
+     "36592a3c3e0dfcff6e0efcf362b2a8e68eb0a1563c041ba4272309536ae39b47"},
+    {LONG, 72, 64,
+     "2c6f5fa62d9b0549bfaae2b39e99afca0e624754e43f71bf8b2df8ead7151e36"
+     "94fb51c7b4ec6de9b4f66426863ce4a520d7f84db5051250f5b4181f04aa4949"},
+    {LONG, 72, 65,
+     "9321f69a406e6ab17f116b5bdc619b9e794806601069888795e1e36eb382839f"
+     "6189ffa17b35028daabbc9bf1db409643b9981fb4bb1764fb33325cdb6deafba"
+     "d6"},
+    {LONG, 72, 100,
+     "a6a4f85de6c6002f987ac446963978bfbee889ede3ae0294be1285c0b0fc116c"
+     "98ccb83336a570db0417d4177b247e2fc0634ffaca7db6be891e265c40b16700"
+     "527240b966318e78c479189553dedb9d31e76f1dae0f1d4e3f44a68b05466e1b"
+     "ceb8737e"},
+    {LONG, 72, 300,
+     "67987c981a1220dfdfe8f9715c9c7617ea9df65b9d5117b73a0f22fd1261cc99"
+     "8e92a8e61a4956af0ad25703679d7f0f39289d446e1fda5f824baefa08f7de0e"
+     "7f769c6a92a1fcf33f00a5d83176ea84d5395c845d58be0d74a1bb88944ae4c4"
+     "0ab26692a7039e54b5116054e0f1a4997560473ff8210864291d3ab7ecace2f9"
+     "287fa4749359fb95004331cb55dc58250855fa5a76616adc7757da8af7e4f4ca"
+     "88f7f13432edcb961e8639340924f209f6f2b4d3fd74f97cc27ef0e9db4c47d1"
+     "6c182eecd76a05d7d30c196f79156dcc15a0ead64997d87844e9ff4689c06951"
+     "b7aa208b982fc357a1ebd166a3b13f4d6ed49cb167af751cffdc9e75b52ce31f"
+     "5855f2d3ec57abd41c95e27730b2b370d3fd363c7cdc18842329d06f6189044f"
+     "ea33dd52e58147fa62b9d9ca"},
+};
+
+static void PrintHex(const uint8_t *bytes, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        printf("%2.2x", bytes[i]);
+    }
+    printf("\n");
+}
+
+/* Lengths of the multi-buffer checks: around the 128-byte block and the 64-byte digest */
+static const uint32_t multi_inlens[] = {0, 1, 72, 127, 128, 129, 256, 1024};
+static const uint32_t multi_outlens[] = {1, 32, 64, 65, 128, 512};
+
+/* Largest number of messages of one multi-buffer call: two full groups of 8 and a partial one */
+#define MULTI_MAX_COUNT 17
+
+/*
+ * Hashes @count messages with the multi-buffer function and compares every lane with the scalar hash of its own
+ * input. The inputs differ in every byte between the lanes, so lanes that are swapped, mixed or hashed with the
+ * length of another call do not match
+ * @return Number of lanes that do not match
+ */
+static unsigned CheckMultiBuffer(bool long_hash, uint32_t inlen, uint32_t outlen, size_t count) {
+    static uint8_t in[MULTI_MAX_COUNT][1024];
+    static uint8_t out[MULTI_MAX_COUNT][512];
+    uint8_t expected[512];
+    void *outs[MULTI_MAX_COUNT];
+    const void *ins[MULTI_MAX_COUNT];
+    for (size_t i = 0; i < count; ++i) {
+        for (uint32_t j = 0; j < inlen; ++j) {
+            in[i][j] = (uint8_t) (j * 7 + i * 31 + inlen);
+        }
+        memset(out[i], 0, sizeof(out[i]));
+        outs[i] = out[i];
+        ins[i] = in[i];
+    }
+    int result = long_hash ? blake2b_long_multi(outs, outlen, ins, inlen, count)
+                           : blake2b_multi(outs, outlen, ins, inlen, count);
+
+    unsigned failures = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int expected_result = long_hash ? blake2b_long(expected, outlen, in[i], inlen)
+                                        : blake2b(expected, outlen, in[i], inlen, NULL, 0);
+        if (0 != result || 0 != expected_result || 0 != memcmp(out[i], expected, outlen)) {
+            printf("BLAKE2b multi-buffer %s inlen %u outlen %u count %u: lane %u failed\n",
+                   long_hash ? "long" : "plain", inlen, outlen, (unsigned) count, (unsigned) i);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main() {
+    uint8_t key[BLAKE2B_KEYBYTES];
+    uint8_t in[2048];
+    uint8_t out[512];
+    char hex[2 * sizeof(out) + 1];
+    unsigned failures = 0;
+    const size_t count = sizeof(blake2b_kats) / sizeof(blake2b_kats[0]);
+
+    for (unsigned i = 0; i < sizeof(key); ++i) {
+        key[i] = (uint8_t) i;
+    }
+
+    for (size_t k = 0; k < count; ++k) {
+        const Blake2bKat &kat = blake2b_kats[k];
+        int result = -1;
+
+        for (uint32_t i = 0; i < kat.inlen; ++i) {
+            in[i] = (uint8_t) i;
+        }
+        if (PLAIN == kat.mode && 3 == kat.inlen) {
+            memcpy(in, "abc", 3);
+        }
+
+        memset(out, 0, sizeof(out));
+        switch (kat.mode) {
+            case KEYED:
+                result = blake2b(out, kat.outlen, in, kat.inlen, key, sizeof(key));
+                break;
+            case PLAIN:
+                result = blake2b(out, kat.outlen, in, kat.inlen, NULL, 0);
+                break;
+            case LONG:
+                result = blake2b_long(out, kat.outlen, in, kat.inlen);
+                break;
+        }
+
+        for (uint32_t i = 0; i < kat.outlen; ++i) {
+            sprintf(hex + 2 * i, "%2.2x", out[i]);
+        }
+
+        if (0 != result || 0 != strcmp(hex, kat.hex)) {
+            printf("BLAKE2b KAT %u (mode %d, inlen %u, outlen %u) failed:\n",
+                   (unsigned) k, (int) kat.mode, kat.inlen, kat.outlen);
+            PrintHex(out, kat.outlen);
+            failures++;
+        }
+    }
+
+    /* Every count up to two full groups and a partial one, at all lengths */
+    for (size_t n = 1; n <= 2 * blake2b_multi_lanes() + 1 && n <= MULTI_MAX_COUNT; ++n) {
+        for (uint32_t inlen : multi_inlens) {
+            for (uint32_t outlen : multi_outlens) {
+                if (outlen <= BLAKE2B_OUTBYTES) {
+                    failures += CheckMultiBuffer(false, inlen, outlen, n);
+                }
+                failures += CheckMultiBuffer(true, inlen, outlen, n);
+            }
+        }
+    }
+
+    printf("BLAKE2b (%s, %u-way multi-buffer): %u failures in %u KAT\n",
+           blake2b_implementation(), (unsigned) blake2b_multi_lanes(), failures,
+           (unsigned) count);
+    return (0 == failures) ? 0 : 1;
+}
@@ -0,0 +1,234 @@
+/*
+ * Argon2 source code package
+ *
+ * Written by Daniel Dinu and Dmitry Khovratovich, 2015
+ *
+ * This work is licensed under a Creative Commons CC0 1.0 License/Waiver.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along with
+ * this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "argon2.h"
+#include "argon2-core.h"
+#include "blake2.h"
+#include "cycles.h"
+
+/*
+ * Measures the core primitives one by one, without the memory traffic, threads and hashing of a whole Argon2 call.
+ * Inputs are either the same few blocks on every call (hot, they stay in L1) or blocks picked at random from a
+ * buffer much larger than the caches (cold). A binary covers the core and the BLAKE2b variant it is built with:
+ * run it from both "make" and "make OPT=TRUE" builds to compare the implementations.
+ */
+
+/*
+ * How every kernel is measured
+ */
+struct KernelConfig {
+    uint32_t repeats; //measured rounds of calls, the median round is reported
+    uint32_t cold_blocks; //size of the cold buffer in blocks
+    const char* format; //"text" or "csv"
+};
+
+/*
+ * Value that every kernel folds its output into, so that the calls are not optimized away
+ */
+static volatile uint64_t sink;
+
+/*
+ * Calls @a kernel(i) @a calls times per round and prints the median time and cycles per call
+ */
+template <typename Kernel>
+static void Measure(const KernelConfig& config, const char* name, const char* inputs, uint32_t calls, Kernel kernel) {
+    std::vector<double> seconds, cycles;
+    for (uint32_t r = 0; r <= config.repeats; ++r) {
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        uint64_t start_cycles = rdtsc();
+        for (uint32_t i = 0; i < calls; ++i) {
+            kernel(i);
+        }
+        uint64_t stop_cycles = rdtsc();
+        std::chrono::steady_clock::time_point stop_time = std::chrono::steady_clock::now();
+        if (r > 0) { // the first round is a warm-up
+            seconds.push_back(std::chrono::duration<double>(stop_time - start_time).count() / calls);
+            cycles.push_back((double) (stop_cycles - start_cycles) / calls);
+        }
+    }
+    std::sort(seconds.begin(), seconds.end());
+    std::sort(cycles.begin(), cycles.end());
+    const double ns = 1e9 * seconds[seconds.size() / 2];
+    const double cpc = cycles[cycles.size() / 2];
+
+    if (!strcmp(config.format, "csv")) {
+        printf("%s,%s,%s,%s,%u,%.2f,%.1f\n", ARGON2_IMPLEMENTATION, blake2b_implementation(), name, inputs, calls, ns,
+                cpc);
+    } else {
+        printf("%-36s %-5s %10.1f ns %10.0f cycles\n", name, inputs, ns, cpc);
+    }
+    fflush(stdout);
+}
+
+void usage(const char* cmd) {
+    printf("Usage:  %s [-repeat N] [-cold MiB] [-format text|csv]\n", cmd);
+    printf("Parameters:\n");
+    printf("\t-repeat N\tMeasured rounds of every kernel, the median is reported (default 5)\n");
+    printf("\t-cold MiB\tSize of the buffer the cold inputs are taken from (default 256)\n");
+    printf("\t-format\t\tOutput format (default text)\n");
+}
+
+int main(int argc, char* argv[]) {
+    KernelConfig config;
+    config.repeats = 5;
+    config.cold_blocks = 256 * 1024;
+    config.format = "text";
+    for (int i = 1; i < argc; ++i) {
+        if (i == argc - 1) {
+            usage(argv[0]);
+            return ARGON2_MISSING_ARGS;
+        }
+        const char* a = argv[i];
+        const char* value = argv[++i];
+        unsigned long input = strtoul(value, NULL, 10);
+        if (!strcmp(a, "-repeat") && input > 0) {
+            config.repeats = (uint32_t) input;
+        } else if (!strcmp(a, "-cold") && input > 0 && input <= 1024 * 1024) {
+            config.cold_blocks = (uint32_t) input * 1024;
+        } else if (!strcmp(a, "-format") && (!strcmp(value, "text") || !strcmp(value, "csv"))) {
+            config.format = value;
+        } else {
+            usage(argv[0]);
+            return ARGON2_INCORRECT_PARAMETER;
+        }
+    }
+
+    // Cold inputs: blocks of a large buffer in random order, so that neither the caches nor the prefetcher help
+    std::vector<block> cold(config.cold_blocks, block(0));
+    std::vector<uint32_t> order(config.cold_blocks);
+    std::mt19937_64 random(1);
+    for (uint32_t i = 0; i < config.cold_blocks; ++i) {
+        order[i] = i;
+        for (uint32_t j = 0; j < ARGON2_WORDS_IN_BLOCK; j += 8) {
+            cold[i].v[j] = random(); // one word per cache line is enough to fault in and vary the pages
+        }
+    }
+    std::shuffle(order.begin(), order.end(), random);
+    const uint32_t cold_mask = config.cold_blocks - 1; // calls wrap around with a modulo otherwise
+    const bool cold_pow2 = (config.cold_blocks & cold_mask) == 0;
+    auto cold_block = [&](uint32_t i) -> block* {
+        return &cold[order[cold_pow2 ? (i & cold_mask) : (i % config.cold_blocks)]];
+    };
+
+    // Hot inputs and an Sbox made as in Argon2ds
+    std::vector<block> hot(3, block(0));
+    for (uint32_t j = 0; j < ARGON2_WORDS_IN_BLOCK; ++j) {
+        hot[0].v[j] = random();
+        hot[1].v[j] = random();
+    }
+    Argon2_instance_t sbox_instance(Argon2_ds, 1, 2 * ARGON2_SYNC_POINTS, 1, 1, false);
+    sbox_instance.lane_memory.assign(1, &hot[0]);
+    GenerateSbox(&sbox_instance);
+    const uint64_t* Sbox = sbox_instance.Sbox;
+
+    if (!strcmp(config.format, "csv")) {
+        printf("implementation,blake2b,kernel,inputs,calls,ns_per_call,cycles_per_call\n");
+    } else {
+        printf("Implementation: %s, BLAKE2b: %s, cold buffer %u MiB, median of %u rounds\n\n", ARGON2_IMPLEMENTATION,
+                blake2b_implementation(), config.cold_blocks / 1024, config.repeats);
+    }
+
+    /* 1. FillBlock, with and without the Sbox */
+    const uint32_t fill_calls = 1 << 16;
+    Measure(config, "FillBlock", "hot", fill_calls, [&](uint32_t) {
+        FillBlock(&hot[0], &hot[1], &hot[2], NULL);
+        sink += hot[2].v[0];
+    });
+    Measure(config, "FillBlock", "cold", fill_calls, [&](uint32_t i) {
+        block* next = cold_block(3 * i + 2);
+        FillBlock(cold_block(3 * i), cold_block(3 * i + 1), next, NULL);
+        sink += next->v[0];
+    });
+    Measure(config, "FillBlock with Sbox", "hot", fill_calls, [&](uint32_t) {
+        FillBlock(&hot[0], &hot[1], &hot[2], Sbox);
+        sink += hot[2].v[0];
+    });
+    Measure(config, "FillBlock with Sbox", "cold", fill_calls, [&](uint32_t i) {
+        block* next = cold_block(3 * i + 2);
+        FillBlock(cold_block(3 * i), cold_block(3 * i + 1), next, Sbox);
+        sink += next->v[0];
+    });
+
+    /* 2. GenerateAddresses for one address block: a segment of ARGON2_ADDRESSES_IN_BLOCK blocks */
+    Argon2_instance_t address_instance(Argon2_i, 1, ARGON2_ADDRESSES_IN_BLOCK * ARGON2_SYNC_POINTS, 1, 1, false);
+    Measure(config, "GenerateAddresses (128 addresses)", "hot", fill_calls / 2, [&](uint32_t i) {
+        Argon2_position_t position(0, 0, (uint8_t) (i % ARGON2_SYNC_POINTS), 0);
+        GenerateAddresses(&address_instance, &position, hot[2].v);
+        sink += hot[2].v[i % ARGON2_ADDRESSES_IN_BLOCK];
+    });
+    Measure(config, "GenerateAddresses (128 addresses)", "cold", fill_calls / 2, [&](uint32_t i) {
+        Argon2_position_t position(0, 0, (uint8_t) (i % ARGON2_SYNC_POINTS), 0);
+        block* addresses = cold_block(i);
+        GenerateAddresses(&address_instance, &position, addresses->v);
+        sink += addresses->v[i % ARGON2_ADDRESSES_IN_BLOCK];
+    });
+
+    /* 3. IndexAlpha in the later passes of 4 GiB in 4 lanes, where the reference area is largest */
+    Argon2_instance_t index_instance(Argon2_d, 2, 1 << 22, 4, 1, false);
+    Measure(config, "IndexAlpha", "hot", 1 << 24, [&](uint32_t i) {
+        Argon2_position_t position(1, 0, (uint8_t) (i % ARGON2_SYNC_POINTS), i % index_instance.segment_length);
+        sink += IndexAlpha(&index_instance, &position, i * 0x9E3779B9u, (i & 1) != 0);
+    });
+
+    /* 4. blake2b_long as used for the first blocks (1024 bytes from a seed) and for the tag (32 bytes of a block) */
+    uint8_t seed[ARGON2_PREHASH_SEED_LENGTH];
+    memcpy(seed, hot[0].v, sizeof (seed));
+    Measure(config, "blake2b_long 1024 B from seed", "hot", fill_calls, [&](uint32_t i) {
+        seed[0] = (uint8_t) i;
+        blake2b_long(hot[2].v, ARGON2_BLOCK_SIZE, seed, sizeof (seed));
+        sink += hot[2].v[0];
+    });
+    Measure(config, "blake2b_long 1024 B from seed", "cold", fill_calls, [&](uint32_t i) {
+        block* out = cold_block(i);
+        seed[0] = (uint8_t) i;
+        blake2b_long(out->v, ARGON2_BLOCK_SIZE, seed, sizeof (seed));
+        sink += out->v[0];
+    });
+    uint8_t tag[32];
+    Measure(config, "blake2b_long 32 B from 1024 B", "hot", fill_calls, [&](uint32_t) {
+        blake2b_long(tag, sizeof (tag), hot[0].v, ARGON2_BLOCK_SIZE);
+        sink += tag[0];
+    });
+    Measure(config, "blake2b_long 32 B from 1024 B", "cold", fill_calls, [&](uint32_t i) {
+        blake2b_long(tag, sizeof (tag), cold_block(i)->v, ARGON2_BLOCK_SIZE);
+        sink += tag[0];
+    });
+
+    /* 5. InitialHash of a 32-byte password and a 16-byte salt */
+    uint8_t pwd[32], salt[16], blockhash[ARGON2_PREHASH_SEED_LENGTH];
+    memcpy(pwd, hot[0].v, sizeof (pwd));
+    memcpy(salt, hot[1].v, sizeof (salt));
+    Argon2_Context context(tag, sizeof (tag), pwd, sizeof (pwd), salt, sizeof (salt), NULL, 0, NULL, 0, 3, 1 << 12,
+            1, 1, NULL, NULL, false, false, false, false);
+    Measure(config, "InitialHash", "hot", fill_calls, [&](uint32_t) {
+        InitialHash(blockhash, &context, Argon2_id);
+        sink += blockhash[0];
+    });
+
+    /* 6. GenerateSbox of Argon2ds, done once per pass */
+    Measure(config, "GenerateSbox", "hot", fill_calls / 64, [&](uint32_t) {
+        GenerateSbox(&sbox_instance);
+        sink += sbox_instance.Sbox[0];
+    });
+
+    delete[] sbox_instance.Sbox;
+    return ARGON2_OK;
+}
@@ -0,0 +1,463 @@
+/*
+ * Argon2 source code package
+ *
+ * Written by Daniel Dinu and Dmitry Khovratovich, 2015
+ *
+ * This work is licensed under a Creative Commons CC0 1.0 License/Waiver.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along with
+ * this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "argon2.h"
+#include "blake2.h"
+
+/*
+ * Load generator that simulates a login service: client threads issue hash or verify calls, either back to back
+ * (closed loop) or on a fixed schedule for a target total rate (open loop). Every concurrency level of the sweep
+ * reports the sustained rate and the latency percentiles; the knee is the last level that still raised the rate.
+ */
+
+typedef std::chrono::steady_clock Clock;
+
+/* Mantissa bits of the latency histogram: values are kept with a relative error below 2^-LATENCY_MANTISSA_BITS */
+const uint32_t LATENCY_MANTISSA_BITS = 5;
+const uint32_t LATENCY_SUB_BUCKETS = 1 << LATENCY_MANTISSA_BITS;
+const uint32_t LATENCY_BUCKETS = (64 - LATENCY_MANTISSA_BITS) * LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS;
+
+/* A concurrency level is past the knee if it raises the rate by less than this fraction */
+const double LOAD_KNEE_GAIN = 0.05;
+
+/*
+ * Log-linear histogram of latencies in nanoseconds, as in HdrHistogram: every power of two is split into
+ * LATENCY_SUB_BUCKETS linear buckets, so recording is constant time and the memory is fixed
+ */
+struct LatencyHistogram {
+    std::vector<uint64_t> counts; //number of values in every bucket
+    uint64_t total; //number of values
+    uint64_t max; //largest value
+
+    LatencyHistogram() : counts(LATENCY_BUCKETS, 0), total(0), max(0) {
+    }
+
+    static uint32_t Index(uint64_t value) {
+        if (value < 2 * LATENCY_SUB_BUCKETS) {
+            return (uint32_t) value;
+        }
+        const uint32_t shift = 63 - __builtin_clzll(value) - LATENCY_MANTISSA_BITS;
+        return shift * LATENCY_SUB_BUCKETS + (uint32_t) (value >> shift);
+    }
+
+    /* Largest value that falls into bucket @a index */
+    static uint64_t Highest(uint32_t index) {
+        if (index < 2 * LATENCY_SUB_BUCKETS) {
+            return index;
+        }
+        const uint32_t shift = index / LATENCY_SUB_BUCKETS - 1;
+        const uint64_t mantissa = index - shift * LATENCY_SUB_BUCKETS;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    void Record(uint64_t value) {
+        counts[Index(value)]++;
+        total++;
+        max = std::max(max, value);
+    }
+
+    void Add(const LatencyHistogram& other) {
+        for (uint32_t i = 0; i < LATENCY_BUCKETS; ++i) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        max = std::max(max, other.max);
+    }
+
+    /* Value below which @a fraction of the recorded values lie, to the bucket precision */
+    uint64_t Percentile(double fraction) const {
+        const uint64_t rank = (uint64_t) (fraction * total + 0.5);
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < LATENCY_BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank && seen > 0) {
+                return std::min(Highest(i), max);
+            }
+        }
+        return max;
+    }
+};
+
+/*
+ * What the clients do and for how long
+ */
+struct LoadConfig {
+    Argon2_type type; //Argon2 type
+    uint32_t m_cost, t_cost, lanes, threads; //parameters of every call
+    bool verify; //issue Verify() calls instead of hashing
+    bool pool; //take the memory of all calls from one pool
+    double rate; //target calls per second of all clients together, 0 for a closed loop
+    double warmup; //seconds before the measurement of a level
+    double duration; //measured seconds of a level
+    std::vector<uint32_t> clients; //concurrency levels of the sweep
+    const char* format; //"text", "json" or "csv"
+    const char* trace; //path of the Chrome trace of all calls, NULL to not trace them
+    const char* metrics; //path of the library metrics after the sweep in Prometheus text format, NULL to skip them
+};
+
+/*
+ * Shared state of the clients of one level
+ */
+struct LoadRun {
+    const LoadConfig* config;
+    uint32_t clients; //number of clients
+    Argon2_MemoryPool* pool; //NULL if the calls allocate their own memory
+    Argon2_ChromeTrace* trace; //sink of the trace records of all calls, NULL if not traced
+    uint8_t tag[32]; //tag that the verify calls expect
+    Clock::time_point start; //start of the warm-up
+    Clock::time_point measure; //end of the warm-up
+    Clock::time_point stop; //end of the measurement
+    std::vector<LatencyHistogram> histograms; //one per client
+    std::vector<uint64_t> completed; //calls completed during the measurement, per client
+    std::atomic<int> error; //first error code of a call
+};
+
+/*
+ * Hashes, or verifies against @a run->tag, a password that depends on @a sequence
+ */
+static int Call(LoadRun* run, uint32_t sequence) {
+    const LoadConfig* config = run->config;
+    uint8_t out[sizeof run->tag], pwd[16], salt[16];
+    memset(pwd, 0, sizeof pwd);
+    memcpy(pwd, &sequence, sizeof sequence);
+    memset(salt, 1, sizeof salt);
+    if (config->verify) {
+        memset(pwd, 0, sizeof pwd); // every verify call checks the correct password
+    }
+    Argon2_Context context(config->verify ? NULL : out, sizeof out, pwd, sizeof pwd, salt, sizeof salt, NULL, 0, NULL, 0,
+            config->t_cost, config->m_cost, config->lanes, config->threads, NULL, NULL, false, false, false, false);
+    context.memory_pool = run->pool;
+    if (NULL != run->trace) {
+        context.trace_cbk = ChromeTraceCallback;
+        context.trace_user = run->trace;
+    }
+    if (config->verify) {
+        return Verify(config->type, &context, run->tag);
+    }
+    switch (config->type) {
+    case Argon2_d:
+        return Argon2d(&context);
+    case Argon2_i:
+        return Argon2i(&context);
+    case Argon2_id:
+        return Argon2id(&context);
+    default:
+        return Argon2ds(&context);
+    }
+}
+
+static void Client(LoadRun* run, uint32_t client) {
+    const LoadConfig* config = run->config;
+    // In the open loop the calls of all clients are interleaved on one schedule of @rate per second
+    const double interval = (config->rate > 0) ? run->clients / config->rate : 0;
+    Clock::time_point scheduled = run->start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(interval * client / run->clients));
+    for (uint32_t sequence = client; ; sequence += run->clients) {
+        Clock::time_point begin = Clock::now();
+        if (config->rate > 0) {
+            if (scheduled > begin) {
+                std::this_thread::sleep_until(scheduled);
+            }
+            begin = scheduled; // the latency includes the time the call waited behind late ones
+            scheduled += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interval));
+        }
+        if (begin >= run->stop) {
+            return;
+        }
+        int code = Call(run, sequence);
+        Clock::time_point end = Clock::now();
+        if (code != ARGON2_OK) {
+            int expected = ARGON2_OK;
+            run->error.compare_exchange_strong(expected, code);
+            return;
+        }
+        if (begin >= run->measure && end <= run->stop) {
+            run->histograms[client].Record((uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+            run->completed[client]++;
+        }
+    }
+}
+
+/*
+ * Results of one concurrency level
+ */
+struct LoadResult {
+    uint32_t clients;
+    double rate; //calls per second
+    LatencyHistogram latency;
+};
+
+/*
+ * Runs one concurrency level
+ * @return ARGON2_OK or the error code of the first failed call
+ */
+static int RunLevel(const LoadConfig& config, uint32_t clients, Argon2_MemoryPool* pool, Argon2_ChromeTrace* trace,
+        const uint8_t* tag, LoadResult* result) {
+    LoadRun run;
+    run.config = &config;
+    run.clients = clients;
+    run.pool = pool;
+    run.trace = trace;
+    memcpy(run.tag, tag, sizeof run.tag);
+    run.histograms.assign(clients, LatencyHistogram());
+    run.completed.assign(clients, 0);
+    run.error = ARGON2_OK;
+    run.start = Clock::now();
+    run.measure = run.start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.warmup));
+    run.stop = run.measure + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.duration));
+
+    std::vector<std::thread> Threads;
+    for (uint32_t c = 0; c < clients; ++c) {
+        Threads.push_back(std::thread(Client, &run, c));
+    }
+    for (auto& t : Threads) {
+        t.join();
+    }
+    if (run.error != ARGON2_OK) {
+        return run.error;
+    }
+
+    result->clients = clients;
+    result->latency = LatencyHistogram();
+    uint64_t completed = 0;
+    for (uint32_t c = 0; c < clients; ++c) {
+        result->latency.Add(run.histograms[c]);
+        completed += run.completed[c];
+    }
+    result->rate = completed / config.duration;
+    return ARGON2_OK;
+}
+
+static void PrintResult(const LoadConfig& config, const LoadResult& r, bool first) {
+    const double ms = 1e-6;
+    if (!strcmp(config.format, "csv")) {
+        printf("%s,%s,%u,%u,%u,%u,%s,%.1f,%u,%.2f,%llu,%.3f,%.3f,%.3f,%.3f,%.3f\n", ARGON2_IMPLEMENTATION,
+                config.verify ? "verify" : "hash", config.m_cost, config.t_cost, config.lanes, config.threads,
+                config.rate > 0 ? "open" : "closed", config.rate, r.clients, r.rate, (unsigned long long) r.latency.total,
+                ms * r.latency.Percentile(0.5), ms * r.latency.Percentile(0.9), ms * r.latency.Percentile(0.99),
+                ms * r.latency.Percentile(0.999), ms * r.latency.max);
+    } else if (!strcmp(config.format, "json")) {
+        printf("%s\n    {\"clients\": %u, \"rate\": %.2f, \"calls\": %llu, \"p50_ms\": %.3f, \"p90_ms\": %.3f, "
+                "\"p99_ms\": %.3f, \"p999_ms\": %.3f, \"max_ms\": %.3f}", first ? "" : ",", r.clients, r.rate,
+                (unsigned long long) r.latency.total, ms * r.latency.Percentile(0.5), ms * r.latency.Percentile(0.9),
+                ms * r.latency.Percentile(0.99), ms * r.latency.Percentile(0.999), ms * r.latency.max);
+    } else {
+        printf("%4u clients:  %9.1f calls/s  p50 %8.3f ms  p90 %8.3f ms  p99 %8.3f ms  p99.9 %8.3f ms  max %8.3f ms\n",
+                r.clients, r.rate, ms * r.latency.Percentile(0.5), ms * r.latency.Percentile(0.9),
+                ms * r.latency.Percentile(0.99), ms * r.latency.Percentile(0.999), ms * r.latency.max);
+    }
+    fflush(stdout);
+}
+
+void usage(const char* cmd) {
+    printf("Usage:  %s [-type d|i|id|ds] [-m N] [-t N] [-lanes N] [-threads N] [-verify] [-pool]\n"
+           "        [-clients N,...] [-rate R] [-warmup S] [-duration S] [-format text|json|csv]\n"
+           "        [-trace path] [-metrics path]\n", cmd);
+    printf("Parameters:\n");
+    printf("\t-type\t\tArgon2 type (default id)\n");
+    printf("\t-m N\t\tMemory of every call, 2^N KiB (default 12)\n");
+    printf("\t-t N\t\tPasses (default %u)\n", ARGON2_T_COST_DEF);
+    printf("\t-lanes N\tLanes of every call (default 1)\n");
+    printf("\t-threads N\tThreads of every call (default 1)\n");
+    printf("\t-verify\t\tClients verify a password instead of hashing new ones\n");
+    printf("\t-pool\t\tAll calls take their memory from one pool\n");
+    printf("\t-clients\tConcurrency levels of the sweep (default 1,2,4,8,16)\n");
+    printf("\t-rate R\t\tOpen loop: R calls per second of all clients together (default: closed loop)\n");
+    printf("\t-warmup S\tSeconds before measuring each level (default 1)\n");
+    printf("\t-duration S\tMeasured seconds of each level (default 5)\n");
+    printf("\t-format\t\tOutput format (default text)\n");
+    printf("\t-trace path\tWrites the phases and segments of all calls to path as Chrome trace-event JSON\n");
+    printf("\t-metrics path\tWrites the library metrics after the sweep to path in Prometheus text format\n");
+}
+
+int main(int argc, char* argv[]) {
+    LoadConfig config;
+    config.type = Argon2_id;
+    config.m_cost = 1 << ARGON2_LOG_M_COST_DEF;
+    config.t_cost = ARGON2_T_COST_DEF;
+    config.lanes = 1;
+    config.threads = 1;
+    config.verify = false;
+    config.pool = false;
+    config.rate = 0;
+    config.warmup = 1;
+    config.duration = 5;
+    config.clients = {1, 2, 4, 8, 16};
+    config.format = "text";
+    config.trace = NULL;
+    config.metrics = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (!strcmp(a, "-verify")) {
+            config.verify = true;
+            continue;
+        }
+        if (!strcmp(a, "-pool")) {
+            config.pool = true;
+            continue;
+        }
+        if (i == argc - 1) {
+            usage(argv[0]);
+            return ARGON2_MISSING_ARGS;
+        }
+        const char* value = argv[++i];
+        const unsigned long input = strtoul(value, NULL, 10);
+        bool valid = true;
+        if (!strcmp(a, "-type")) {
+            valid = !strcmp(value, "d") || !strcmp(value, "i") || !strcmp(value, "id") || !strcmp(value, "ds");
+            config.type = !strcmp(value, "d") ? Argon2_d : !strcmp(value, "i") ? Argon2_i :
+                          !strcmp(value, "ds") ? Argon2_ds : Argon2_id;
+        } else if (!strcmp(a, "-m")) {
+            valid = input > 0 && input <= ARGON2_MAX_MEMORY_BITS;
+            config.m_cost = ARGON2_MIN(UINT64_C(1) << input, UINT32_C(0xFFFFFFFF));
+        } else if (!strcmp(a, "-t")) {
+            valid = input > 0 && input <= ARGON2_MAX_TIME;
+            config.t_cost = (uint32_t) input;
+        } else if (!strcmp(a, "-lanes")) {
+            valid = input > 0 && input <= ARGON2_MAX_LANES;
+            config.lanes = (uint32_t) input;
+        } else if (!strcmp(a, "-threads")) {
+            valid = input > 0 && input <= ARGON2_MAX_THREADS;
+            config.threads = (uint32_t) input;
+        } else if (!strcmp(a, "-clients")) {
+            config.clients.clear();
+            for (const char* text = value; valid && *text; ) {
+                char* end;
+                unsigned long clients = strtoul(text, &end, 10);
+                valid = end != text && clients > 0 && clients <= 4096 && (*end == ',' || *end == 0);
+                config.clients.push_back((uint32_t) clients);
+                text = (*end == ',') ? end + 1 : end;
+            }
+            valid = valid && !config.clients.empty();
+        } else if (!strcmp(a, "-rate")) {
+            config.rate = atof(value);
+            valid = config.rate >= 0;
+        } else if (!strcmp(a, "-warmup")) {
+            config.warmup = atof(value);
+            valid = config.warmup >= 0;
+        } else if (!strcmp(a, "-duration")) {
+            config.duration = atof(value);
+            valid = config.duration > 0;
+        } else if (!strcmp(a, "-format")) {
+            valid = !strcmp(value, "text") || !strcmp(value, "json") || !strcmp(value, "csv");
+            config.format = value;
+        } else if (!strcmp(a, "-trace")) {
+            config.trace = value;
+        } else if (!strcmp(a, "-metrics")) {
+            config.metrics = value;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            usage(argv[0]);
+            return ARGON2_INCORRECT_PARAMETER;
+        }
+    }
+
+    // The tag of the password that every verify call checks
+    uint8_t tag[32], pwd[16], salt[16];
+    memset(pwd, 0, sizeof pwd);
+    memset(salt, 1, sizeof salt);
+    Argon2_Context context(tag, sizeof tag, pwd, sizeof pwd, salt, sizeof salt, NULL, 0, NULL, 0,
+            config.t_cost, config.m_cost, config.lanes, config.threads, NULL, NULL, false, false, false, false);
+    int code = config.type == Argon2_d ? Argon2d(&context) : config.type == Argon2_i ? Argon2i(&context) :
+               config.type == Argon2_id ? Argon2id(&context) : Argon2ds(&context);
+    if (code != ARGON2_OK) {
+        fprintf(stderr, "Error: %s\n", ErrorMessage(code));
+        return code;
+    }
+    Argon2_MemoryPool* pool = config.pool ? CreateMemoryPool() : NULL;
+    Argon2_ChromeTrace* trace = NULL;
+    if (NULL != config.trace) {
+        trace = CreateChromeTrace(config.trace);
+        if (NULL == trace) {
+            fprintf(stderr, "Error: %s: %s\n", config.trace, ErrorMessage(ARGON2_TRACE_FILE_ERROR));
+            DestroyMemoryPool(pool);
+            return ARGON2_TRACE_FILE_ERROR;
+        }
+    }
+
+    if (!strcmp(config.format, "csv")) {
+        printf("implementation,operation,m_cost,t_cost,lanes,threads,loop,target_rate,clients,rate,calls,p50_ms,p90_ms,"
+                "p99_ms,p999_ms,max_ms\n");
+    } else if (!strcmp(config.format, "json")) {
+        printf("{\"implementation\": \"%s\", \"blake2b\": \"%s\", \"operation\": \"%s\", \"m_cost\": %u, \"t_cost\": %u, "
+                "\"lanes\": %u, \"threads\": %u, \"target_rate\": %.1f, \"results\": [", ARGON2_IMPLEMENTATION,
+                blake2b_implementation(), config.verify ? "verify" : "hash", config.m_cost, config.t_cost, config.lanes,
+                config.threads, config.rate);
+    } else {
+        printf("Implementation: %s, BLAKE2b: %s, %s with %u KiB, %u passes, %u lanes, %u threads per call, %s loop\n\n",
+                ARGON2_IMPLEMENTATION, blake2b_implementation(), config.verify ? "verify" : "hash", config.m_cost,
+                config.t_cost, config.lanes, config.threads, config.rate > 0 ? "open" : "closed");
+    }
+
+    std::vector<LoadResult> results;
+    for (uint32_t clients : config.clients) {
+        LoadResult result;
+        code = RunLevel(config, clients, pool, trace, tag, &result);
+        if (code != ARGON2_OK) {
+            fprintf(stderr, "Error: %u clients: %s\n", clients, ErrorMessage(code));
+            break;
+        }
+        PrintResult(config, result, results.empty());
+        results.push_back(result);
+    }
+
+    // The knee: the last level whose rate is still clearly above the best rate of the levels before it
+    size_t knee = 0;
+    double best = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].rate > best * (1 + LOAD_KNEE_GAIN)) {
+            knee = i;
+        }
+        best = std::max(best, results[i].rate);
+    }
+    if (!strcmp(config.format, "json")) {
+        printf("\n], \"knee_clients\": %u}\n", results.empty() ? 0 : results[knee].clients);
+    } else if (!strcmp(config.format, "text") && !results.empty()) {
+        printf("\nKnee at %u clients: %.1f calls/s, p99 %.3f ms\n", results[knee].clients, results[knee].rate,
+                1e-6 * results[knee].latency.Percentile(0.99));
+    }
+
+    if (NULL != config.metrics) {
+        Argon2_Metrics metrics;
+        GetMetrics(&metrics);
+        char text[ARGON2_METRICS_TEXT_LENGTH];
+        FILE* file = fopen(config.metrics, "w");
+        if (NULL == file || ARGON2_OK != FormatMetrics(text, sizeof text, &metrics) || EOF == fputs(text, file)) {
+            fprintf(stderr, "Error: can not write the metrics to %s\n", config.metrics);
+        }
+        if (NULL != file) {
+            fclose(file);
+        }
+    }
+
+    DestroyMemoryPool(pool);
+    if (NULL != trace && ARGON2_OK != DestroyChromeTrace(trace)) {
+        fprintf(stderr, "Error: %s: %s\n", config.trace, ErrorMessage(ARGON2_TRACE_FILE_ERROR));
+        if (ARGON2_OK == code) {
+            code = ARGON2_TRACE_FILE_ERROR;
+        }
+    }
+    return code;
+}
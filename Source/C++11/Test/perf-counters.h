@@ -0,0 +1,157 @@
+/*
+ * Argon2 source code package
+ *
+ * Written by Daniel Dinu and Dmitry Khovratovich, 2015
+ *
+ * This work is licensed under a Creative Commons CC0 1.0 License/Waiver.
+ *
+ * You should have received a copy of the CC0 Public Domain Dedication along with
+ * this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+ */
+
+#pragma once
+
+#ifndef __ARGON2_PERF_COUNTERS_H__
+#define __ARGON2_PERF_COUNTERS_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Hardware counters of the benchmarks, read through perf_event_open(2). Only user space is counted, which is what
+ * perf_event_paranoid 2 allows, so the kernel side of page faults is not included. A counter that can not be opened
+ * (no permission, not supported by the CPU or the hypervisor, not Linux) is reported as unavailable
+ */
+enum PerfCounter {
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_STALLED_CYCLES,
+    PERF_COUNTERS
+};
+
+static const char* const PERF_COUNTER_NAMES[PERF_COUNTERS] = {
+    "instructions", "llc_misses", "dtlb_misses", "stalled_cycles"
+};
+
+/*
+ * Values of all counters at one moment, to subtract from a later sample
+ */
+struct PerfSample {
+    uint64_t value[PERF_COUNTERS];
+    uint64_t enabled[PERF_COUNTERS]; //nanoseconds the counter was enabled
+    uint64_t running[PERF_COUNTERS]; //nanoseconds it was on the PMU, less than enabled if counters were multiplexed
+};
+
+struct PerfCounters {
+    int fd[PERF_COUNTERS]; //-1 if the counter is not available
+
+    /*
+     * Opens the counters for the calling thread and the threads it creates from now on
+     */
+    PerfCounters() {
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+            fd[i] = -1;
+        }
+#ifdef __linux__
+        const uint64_t read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        // Candidates per counter, the first one the kernel accepts is used
+        const struct {
+            int counter;
+            uint32_t type;
+            uint64_t config;
+        } events[] = {
+            {PERF_INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_LLC_MISSES, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | read_miss},
+            {PERF_LLC_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_DTLB_MISSES, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | read_miss},
+            {PERF_STALLED_CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+            {PERF_STALLED_CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+        };
+        for (const auto& event : events) {
+            if (fd[event.counter] >= 0) {
+                continue;
+            }
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof (attr));
+            attr.size = sizeof (attr);
+            attr.type = event.type;
+            attr.config = event.config;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.inherit = 1; // Argon2 runs the segments on threads of its own
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd[event.counter] = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+            if (fd[i] >= 0) {
+                close(fd[i]);
+            }
+        }
+#endif
+    }
+
+    bool Available(int counter) const {
+        return fd[counter] >= 0;
+    }
+
+    bool AnyAvailable() const {
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+            if (Available(i)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     * Reads all available counters; the counts of joined threads are included
+     */
+    void Read(PerfSample* sample) const {
+        memset(sample, 0, sizeof (*sample));
+#ifdef __linux__
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+            uint64_t values[3];
+            if (fd[i] >= 0 && read(fd[i], values, sizeof (values)) == (ssize_t) sizeof (values)) {
+                sample->value[i] = values[0];
+                sample->enabled[i] = values[1];
+                sample->running[i] = values[2];
+            }
+        }
+#endif
+    }
+
+    /*
+     * Events of @a counter between two samples, scaled up if the counter was multiplexed
+     * @return Number of events or a negative value if the counter is not available
+     */
+    double Delta(const PerfSample& start, const PerfSample& stop, int counter) const {
+        if (!Available(counter)) {
+            return -1;
+        }
+        const uint64_t running = stop.running[counter] - start.running[counter];
+        const uint64_t enabled = stop.enabled[counter] - start.enabled[counter];
+        if (running == 0) {
+            return -1; // never scheduled on the PMU
+        }
+        return (double) (stop.value[counter] - start.value[counter]) * enabled / running;
+    }
+
+private:
+    PerfCounters(const PerfCounters&);
+    PerfCounters& operator=(const PerfCounters&);
+};
+
+#endif
@@ -18,6 +18,9 @@
 #include <algorithm>
 #include <vector>
 #include <string>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 #include "time.h"
 #include "argon2.h"
@@ -32,6 +35,9 @@ void usage(const char *cmd) {
     printf("Usage:  %s pwd salt [-d] [-t iterations] [-m memory] "
            "[-p parallelism]\n",
            cmd);
+    printf("        %s -bulk [-i file] [-w workers] [-verify] [-type d|i|id|ds] "
+           "[-t iterations] [-m memory] [-p parallelism]\n",
+           cmd);
 
     printf("Parameters:\n");
     printf("\tpwd\t\tThe password to hash\n");
@@ -43,6 +49,35 @@ void usage(const char *cmd) {
            ARGON2_LOG_M_COST_DEF);
     printf("\t-p N\t\tSets parallelism to N threads (default %d)\n",
            ARGON2_THREADS_DEF);
+    printf("Bulk mode:\n");
+    printf("\t-bulk\t\tHashes every line of the input as a password, with a random salt, and\n"
+           "\t\t\twrites the encoded hashes in input order. Statistics go to stderr\n");
+    printf("\t-i file\t\tReads the records from file instead of stdin\n");
+    printf("\t-w N\t\tProcesses the records on N workers (default 1)\n");
+    printf("\t-verify\t\tEvery line is an encoded hash, a space and a password; writes\n"
+           "\t\t\tOK, MISMATCH or the error for each of them\n");
+    printf("\t-type T\t\tArgon2 type of the new hashes: d, i, id or ds (default i)\n");
+}
+
+/*
+Maps a type name of the command line to the Argon2 type
+@name "d", "i", "id" or "ds"
+@type receives the type
+@return false if the name is unknown
+*/
+static bool TypeFromString(const char *name, Argon2_type *type) {
+    if (!strcmp(name, "d")) {
+        *type = Argon2_d;
+    } else if (!strcmp(name, "i")) {
+        *type = Argon2_i;
+    } else if (!strcmp(name, "id")) {
+        *type = Argon2_id;
+    } else if (!strcmp(name, "ds")) {
+        *type = Argon2_ds;
+    } else {
+        return false;
+    }
+    return true;
 }
 
 
@@ -114,18 +149,19 @@ static void Run(uint8_t *out, char *pwd, uint8_t *salt, uint32_t t_cost,
 
     stop_time = clock();
 
-    /* add back when proper decoding */
-    /*
-    char encoded[300];
-    encode_string(encoded, sizeof encoded, &context);
-    printf("%s\n", encoded);
-    */
     printf("Hash:\t\t");
     for (uint32_t i = 0; i < context.outlen; ++i) {
         printf("%02x", context.out[i]);
     }
     printf("\n");
 
+    Argon2_type argon2_type = Argon2_i;
+    TypeFromString(type, &argon2_type);
+    char encoded[300];
+    if (EncodeString(encoded, sizeof encoded, argon2_type, &context) == ARGON2_OK) {
+        printf("Encoded:\t%s\n", encoded);
+    }
+
     printf("%2.3f seconds\n",
            ((double)stop_time - start_time) / (CLOCKS_PER_SEC));
 
@@ -133,6 +169,267 @@ static void Run(uint8_t *out, char *pwd, uint8_t *salt, uint32_t t_cost,
 
 
 
+/* Number of records read, processed and written in one go by the bulk mode, per worker */
+const uint32_t BULK_RECORDS_PER_WORKER = 256;
+
+/*
+Records of the bulk mode that are being processed, shared by the workers
+*/
+struct BulkChunk {
+    std::vector<std::string> records; //input lines
+    std::vector<std::string> results; //output line of every record
+    std::vector<double> latencies; //processing time of every record in seconds
+    std::vector<bool> failed; //whether the record could not be hashed or verified
+    std::atomic<uint32_t> next; //index of the next record to process
+    bool verify; //records are "encoded password" pairs to verify
+    Argon2_type type; //type of the new hashes
+    uint32_t t_cost, m_cost, lanes; //parameters of the new hashes
+    Argon2_MemoryPool *pool; //memory reused by all records
+};
+
+/*
+Hashes a password with a random salt into an encoded string
+@return ARGON2_OK or an error code
+*/
+static int BulkHash(const BulkChunk *chunk, const std::string &password, std::string *result) {
+    uint8_t out[ARGON2_OUT_LEN_DEF];
+    uint8_t salt[ARGON2_SALT_LEN_DEF];
+    static thread_local std::random_device random;
+    for (uint32_t i = 0; i < ARGON2_SALT_LEN_DEF; ++i) {
+        salt[i] = (uint8_t) random();
+    }
+
+    std::vector<uint8_t> pwd(password.begin(), password.end());
+    Argon2_Context context(out, sizeof out, pwd.data(), (uint32_t) pwd.size(), salt, sizeof salt,
+            NULL, 0, NULL, 0, chunk->t_cost, chunk->m_cost, chunk->lanes, 1,
+            NULL, NULL, true, false, false, false);
+    context.memory_pool = chunk->pool;
+    int code;
+    switch (chunk->type) {
+    case Argon2_d:
+        code = Argon2d(&context);
+        break;
+    case Argon2_id:
+        code = Argon2id(&context);
+        break;
+    case Argon2_ds:
+        code = Argon2ds(&context);
+        break;
+    default:
+        code = Argon2i(&context);
+        break;
+    }
+    if (code != ARGON2_OK) {
+        return code;
+    }
+
+    char encoded[300];
+    code = EncodeString(encoded, sizeof encoded, chunk->type, &context);
+    if (code == ARGON2_OK) {
+        *result = encoded;
+    }
+    return code;
+}
+
+/*
+Verifies the "encoded password" records of the chunk with VerifyEncodedBatch() on the workers. The batch reports no
+time per entry, so every record gets the mean time of the chunk per worker
+*/
+static void BulkVerify(BulkChunk *chunk, uint32_t workers) {
+    const size_t count = chunk->records.size();
+    std::vector<const char *> encoded(count);
+    std::vector<const uint8_t *> pwds(count);
+    std::vector<uint32_t> pwdlens(count);
+    std::vector<int> codes(count);
+    for (size_t i = 0; i < count; ++i) {
+        // The record is split in place: the encoded hash is terminated at the space, the password follows it
+        std::string &record = chunk->records[i];
+        size_t space = record.find(' ');
+        if (space == std::string::npos) { // no password: the empty encoded hash fails to decode
+            encoded[i] = "";
+            pwds[i] = (const uint8_t *) record.data();
+            pwdlens[i] = 0;
+            continue;
+        }
+        record[space] = 0;
+        encoded[i] = record.c_str();
+        pwds[i] = (const uint8_t *) record.data() + space + 1;
+        pwdlens[i] = (uint32_t) (record.size() - space - 1);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    VerifyEncodedBatch(encoded.data(), pwds.data(), pwdlens.data(), (uint32_t) count, workers, chunk->pool,
+            codes.data());
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (size_t i = 0; i < count; ++i) {
+        int code = codes[i];
+        chunk->results[i] = (code == ARGON2_OK) ? "OK" : (code == ARGON2_VERIFY_MISMATCH) ? "MISMATCH" :
+                std::string("ERROR ") + ErrorMessage(code);
+        chunk->failed[i] = (code != ARGON2_OK && code != ARGON2_VERIFY_MISMATCH);
+        chunk->latencies[i] = elapsed * ARGON2_MIN((size_t) workers, count) / count;
+        secure_wipe_memory(&chunk->records[i][0], chunk->records[i].size());
+    }
+}
+
+static void BulkWorker(BulkChunk *chunk) {
+    for (uint32_t i = chunk->next++; i < chunk->records.size(); i = chunk->next++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int code = BulkHash(chunk, chunk->records[i], &chunk->results[i]);
+        if (code != ARGON2_OK) {
+            chunk->results[i] = std::string("ERROR ") + ErrorMessage(code);
+        }
+        chunk->failed[i] = (code != ARGON2_OK);
+        chunk->latencies[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        secure_wipe_memory(&chunk->records[i][0], chunk->records[i].size());
+    }
+}
+
+/*
+Value below which @a fraction of the sorted @a values lie
+*/
+static double Percentile(const std::vector<double> &values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t index = (size_t) (fraction * (values.size() - 1) + 0.5);
+    return values[index];
+}
+
+/*
+Bulk mode: hashes or verifies every line of the input on several workers, see usage()
+*/
+static int RunBulk(int argc, char *argv[]) {
+    const char *input_name = NULL;
+    uint32_t workers = 1;
+    const char *type_name = "i";
+    BulkChunk chunk;
+    chunk.verify = false;
+    chunk.t_cost = ARGON2_T_COST_DEF;
+    chunk.m_cost = 1 << ARGON2_LOG_M_COST_DEF;
+    chunk.lanes = ARGON2_LANES_DEF;
+
+    for (int i = 2; i < argc; i++) {
+        const char *a = argv[i];
+        unsigned long input = 0;
+        if (!strcmp(a, "-verify")) {
+            chunk.verify = true;
+            continue;
+        }
+        if (i == argc - 1) {
+            fatal("missing argument");
+        }
+        const char *value = argv[++i];
+        input = strtoul(value, NULL, 10);
+        if (!strcmp(a, "-i")) {
+            input_name = value;
+        } else if (!strcmp(a, "-type")) {
+            type_name = value;
+        } else if (!strcmp(a, "-w")) {
+            if (input == 0 || input > ARGON2_MAX_THREADS) {
+                fatal("bad numeric input for -w");
+            }
+            workers = input;
+        } else if (!strcmp(a, "-m")) {
+            if (input == 0 || input > ARGON2_MAX_MEMORY_BITS) {
+                fatal("bad numeric input for -m");
+            }
+            chunk.m_cost = ARGON2_MIN(UINT64_C(1) << input, UINT32_C(0xFFFFFFFF));
+        } else if (!strcmp(a, "-t")) {
+            if (input == 0 || input == ULONG_MAX || input > ARGON2_MAX_TIME) {
+                fatal("bad numeric input for -t");
+            }
+            chunk.t_cost = input;
+        } else if (!strcmp(a, "-p")) {
+            if (input == 0 || input > ARGON2_MAX_LANES) {
+                fatal("bad numeric input for -p");
+            }
+            chunk.lanes = input;
+        } else {
+            fatal("unknown argument");
+        }
+    }
+    if (!TypeFromString(type_name, &chunk.type)) {
+        fatal("wrong Argon2 type");
+    }
+
+    FILE *input = stdin;
+    if (input_name != NULL) {
+        input = fopen(input_name, "r");
+        if (input == NULL) {
+            fatal("can not open the input file");
+        }
+    }
+    chunk.pool = CreateMemoryPool();
+    if (chunk.pool == NULL) {
+        fatal(ErrorMessage(ARGON2_MEMORY_ALLOCATION_ERROR));
+    }
+
+    std::vector<double> latencies;
+    uint64_t failures = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    char *line = NULL;
+    size_t capacity = 0;
+    bool more = true;
+    while (more) {
+        /* 1. Reading the next chunk of records */
+        chunk.records.clear();
+        ssize_t length;
+        while (chunk.records.size() < (size_t) workers * BULK_RECORDS_PER_WORKER) {
+            length = getline(&line, &capacity, input);
+            if (length < 0) {
+                more = false;
+                break;
+            }
+            while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+                length--;
+            }
+            chunk.records.push_back(std::string(line, length));
+            secure_wipe_memory(line, capacity);
+        }
+
+        /* 2. Processing it on the workers */
+        chunk.results.assign(chunk.records.size(), std::string());
+        chunk.latencies.assign(chunk.records.size(), 0);
+        chunk.failed.assign(chunk.records.size(), false);
+        chunk.next = 0;
+        if (chunk.verify) {
+            BulkVerify(&chunk, workers);
+        } else {
+            std::vector<std::thread> Threads;
+            for (uint32_t w = 1; w < ARGON2_MIN((size_t) workers, chunk.records.size()); ++w) {
+                Threads.push_back(std::thread(BulkWorker, &chunk));
+            }
+            BulkWorker(&chunk);
+            for (auto& t : Threads) {
+                t.join();
+            }
+        }
+
+        /* 3. Writing the results in input order */
+        for (size_t i = 0; i < chunk.results.size(); ++i) {
+            printf("%s\n", chunk.results[i].c_str());
+            failures += chunk.failed[i] ? 1 : 0;
+        }
+        latencies.insert(latencies.end(), chunk.latencies.begin(), chunk.latencies.end());
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    free(line);
+    if (input != stdin) {
+        fclose(input);
+    }
+    DestroyMemoryPool(chunk.pool);
+
+    std::sort(latencies.begin(), latencies.end());
+    fprintf(stderr, "Records:\t%zu (%" PRIu64 " failed)\n", latencies.size(), failures);
+    fprintf(stderr, "Elapsed:\t%.3f seconds\n", elapsed);
+    fprintf(stderr, "Throughput:\t%.1f records/s\n", (elapsed > 0) ? latencies.size() / elapsed : 0.0);
+    fprintf(stderr, "Latency:\tp50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+            1e3 * Percentile(latencies, 0.50), 1e3 * Percentile(latencies, 0.90),
+            1e3 * Percentile(latencies, 0.99), 1e3 * Percentile(latencies, 1.0));
+    return (failures == 0) ? ARGON2_OK : 1;
+}
+
 int main(int argc, char *argv[]) {
     
     unsigned char out[ARGON2_OUT_LEN_DEF];
@@ -145,6 +442,10 @@ int main(int argc, char *argv[]) {
     const char *type = "i";
     int i;
 
+    if (argc >= 2 && !strcmp(argv[1], "-bulk")) {
+        return RunBulk(argc, argv);
+    }
+
     if (argc < 3) {
         usage(argv[0]);
         return ARGON2_MISSING_ARGS;